@@ -0,0 +1 @@
+../ligra/bigAlloc.h
\ No newline at end of file
@@ -0,0 +1 @@
+../ligra/blockRadixSort.h
\ No newline at end of file
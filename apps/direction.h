@@ -0,0 +1 @@
+../ligra/direction.h
\ No newline at end of file
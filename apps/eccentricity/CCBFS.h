@@ -47,7 +47,7 @@ uintE CCBFS(intE start, graph<vertex> GA, intE* Labels) {
     round++;
     numVisited+=Frontier.numNonzeros();
     //apply edgemap
-    vertexSubset output = edgeMap(GA, Frontier, CCBFS_F(label,Labels), GA.m/20);
+    vertexSubset output = edgeMap(GA, Frontier, CCBFS_F(label,Labels), -1);
     Frontier.del();
     Frontier = output; //set new frontier
   } 
@@ -101,7 +101,7 @@ void Components(graph<vertex> GA, intE* IDs) {
     vertexMap(Frontier,CC_Vertex_F(IDs,prevIDs));
     vertexSubset output = 
       edgeMap(GA, Frontier, CC_F(IDs,prevIDs),
-	      GA.m/20);
+	      -1);
     Frontier.del();
     Frontier = output;
   }
@@ -0,0 +1 @@
+../../ligra/byteRLE.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../ligra/csrVertex.h
\ No newline at end of file
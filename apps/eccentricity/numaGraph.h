@@ -0,0 +1 @@
+../../ligra/numaGraph.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../ligra/parallel.h
\ No newline at end of file
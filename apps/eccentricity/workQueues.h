@@ -0,0 +1 @@
+../../ligra/workQueues.h
\ No newline at end of file
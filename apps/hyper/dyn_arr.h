@@ -0,0 +1 @@
+../../ligra/dyn_arr.h
\ No newline at end of file
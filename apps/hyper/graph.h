@@ -0,0 +1 @@
+../../ligra/graph.h
\ No newline at end of file
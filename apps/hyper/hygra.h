@@ -0,0 +1 @@
+../../ligra/hygra.h
\ No newline at end of file
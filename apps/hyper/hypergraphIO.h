@@ -0,0 +1 @@
+../../ligra/hypergraphIO.h
\ No newline at end of file
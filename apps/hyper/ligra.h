@@ -0,0 +1 @@
+../../ligra/ligra.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../ligra/sequentialHT.h
\ No newline at end of file
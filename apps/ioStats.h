@@ -0,0 +1 @@
+../ligra/ioStats.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../ligra/IO.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../utils/blockRadixSort.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../ligra/byte-pd.h
\ No newline at end of file
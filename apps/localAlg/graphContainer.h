@@ -0,0 +1 @@
+../../ligra/graphContainer.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../ligra/sequence.h
\ No newline at end of file
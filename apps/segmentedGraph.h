@@ -0,0 +1 @@
+../ligra/segmentedGraph.h
\ No newline at end of file
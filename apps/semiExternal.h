@@ -0,0 +1 @@
+../ligra/semiExternal.h
\ No newline at end of file
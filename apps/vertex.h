@@ -0,0 +1 @@
+../ligra/vertex.h
\ No newline at end of file
@@ -37,10 +37,86 @@
 #include "quickSort.h"
 #include "utils.h"
 #include "graph.h"
+#include "ioStats.h"
 using namespace std;
 
 typedef pair<uintE,uintE> intPair;
-typedef pair<uintE, pair<uintE,intE> > intTriple;
+typedef pair<uintE, pair<uintE,weightT> > intTriple;
+
+// Vertex IDs are uintE (64-bit with EDGELONG) and edge offsets are uintT
+// (64-bit with LONG), independently of each other: graphs with more than
+// 2^32 edges but fewer than 2^32-1 vertices need LONG but can keep 4-byte
+// IDs. Aborts if the graph does not fit the build; UINT_E_MAX is reserved
+// to mean "no vertex".
+inline void checkWidths(long n, long m) {
+  if ((unsigned long) n >= (unsigned long) UINT_E_MAX) {
+    cout << n << " vertices do not fit 32-bit IDs, compile with EDGELONG" << endl;
+    abort();
+  }
+#ifdef WEIGHTED
+  long slots = 2*m; //the weights are interleaved with the IDs
+#else
+  long slots = m;
+#endif
+  if ((unsigned long) slots > (unsigned long) UINT_T_MAX) {
+    cout << m << " edges do not fit 32-bit offsets, compile with LONG" << endl;
+    abort();
+  }
+}
+
+#ifdef WEIGHTED
+// Weighted edges of one direction (see vertex.h): the IDs interleaved
+// with intE weights or, with SOA, the m IDs followed by the m weights,
+// so that one allocation holds both either way.
+inline void* newWeightedEdges(long m) {
+#ifdef SOA
+  return bigAlloc(m*sizeof(uintE) + m*sizeof(weightT));
+#else
+  return newBigA(intE,2*m);
+#endif
+}
+
+inline weightT toWeight(long w) {
+  weightT r = (weightT) w;
+  if ((long) r != w) {
+    cout << "Weight " << w << " does not fit the weight type" << endl;
+    abort();
+  }
+  return r;
+}
+
+//stores edge k of the m edges in E
+inline void setWeightedEdge(void* E, long m, long k, uintE ngh, weightT w) {
+#ifdef SOA
+  ((uintE*) E)[k] = ngh;
+  ((weightT*) ((uintE*) E + m))[k] = w;
+#else
+  ((intE*) E)[2*k] = ngh;
+  ((intE*) E)[2*k+1] = w;
+#endif
+}
+
+//points the out-edges (in-edges) of v at edge o of the m edges in E
+template <class vertex>
+inline void setOutEdges(vertex& v, void* E, long m, uintT o) {
+#ifdef SOA
+  v.setOutNeighbors((uintE*) E + o);
+  v.setOutWeights((weightT*) ((uintE*) E + m) + o);
+#else
+  v.setOutNeighbors((intE*) E + 2*o);
+#endif
+}
+
+template <class vertex>
+inline void setInEdges(vertex& v, void* E, long m, uintT o) {
+#ifdef SOA
+  v.setInNeighbors((uintE*) E + o);
+  v.setInWeights((weightT*) ((uintE*) E + m) + o);
+#else
+  v.setInNeighbors((intE*) E + 2*o);
+#endif
+}
+#endif
 
 template <class E>
 struct pairFirstCmp {
@@ -69,7 +145,7 @@ struct words {
   words() {}
 words(char* C, long nn, char** S, long mm)
 : Chars(C), n(nn), Strings(S), m(mm) {}
-  void del() {free(Chars); free(Strings);}
+  void del() {bigFree(Chars); free(Strings);}
 };
 
 inline bool isSpace(char c) {
@@ -131,12 +207,27 @@ _seq<char> readStringFromFile(char *fileName) {
   long end = file.tellg();
   file.seekg (0, ios::beg);
   long n = end - file.tellg();
-  char* bytes = newA(char,n+1);
+  char* bytes = newBigA(char,n+1);
   file.read (bytes,n);
   file.close();
   return _seq<char>(bytes,n);
 }
 
+inline bool fileExists(const char* fname) {
+  struct stat sb;
+  return stat(fname, &sb) == 0;
+}
+
+// Releases a file obtained from readStringFromFile or mmapStringFromFile.
+void releaseStringFromFile(_seq<char> S, bool mmapped) {
+  if (mmapped) {
+    if (munmap(S.A, S.n) == -1) {
+      perror("munmap");
+      exit(-1);
+    }
+  } else bigFree(S.A);
+}
+
 // parallel code for converting a string to words
 words stringToWords(char *Str, long n) {
   {parallel_for (long i=0; i < n; i++)
@@ -160,151 +251,217 @@ words stringToWords(char *Str, long n) {
   return words(Str,n,SA,m);
 }
 
-template <class vertex>
-graph<vertex> readGraphFromFile(char* fname, bool isSymmetric, bool mmap) {
-  words W;
-  if (mmap) {
-    _seq<char> S = mmapStringFromFile(fname);
-    char *bytes = newA(char, S.n);
-    // Cannot mutate the graph unless we copy.
-    parallel_for(size_t i=0; i<S.n; i++) {
-      bytes[i] = S.A[i];
-    }
-    if (munmap(S.A, S.n) == -1) {
-      perror("munmap");
-      exit(-1);
+// Returns the index of the first non-space character of S at or after i.
+inline long skipSpace(char* S, long i, long n) {
+  while (i < n && isSpace(S[i])) i++;
+  return i;
+}
+
+// Parses the (possibly negative) decimal integer starting at S[i] into
+// val and returns the index just past its token.
+inline long parseLong(char* S, long i, long n, long& val) {
+  bool neg = (i < n && S[i] == '-');
+  if (neg) i++;
+  long r = 0;
+  while (i < n && S[i] >= '0' && S[i] <= '9') r = 10*r + (S[i++] - '0');
+  while (i < n && !isSpace(S[i])) i++;
+  val = neg ? -r : r;
+  return i;
+}
+
+#define _PARSE_BSIZE (1 << 20)
+
+// Parses the whitespace-separated integers in S[s..e) without copying or
+// tokenizing the text. The text is split into fixed-size blocks, each
+// block counts the tokens that start inside it, and after a scan over the
+// counts each block parses its tokens in place and passes the k-th
+// integer to store(k, val). Returns the number of integers; store is
+// only called if that number equals expected.
+template <class F>
+long parseIntegers(char* S, long s, long e, long expected, F store) {
+  long l = nblocks(e-s, _PARSE_BSIZE);
+  long* counts = newA(long,l);
+  {parallel_for(long b=0; b<l; b++) {
+    long bs = s + b*_PARSE_BSIZE, be = min(bs + _PARSE_BSIZE, e);
+    long c = 0;
+    for (long i=bs; i<be; i++)
+      if (!isSpace(S[i]) && (i == s || isSpace(S[i-1]))) c++;
+    counts[b] = c;
+    }}
+  long total = sequence::plusScan(counts, counts, l);
+  if (total == expected) {
+    parallel_for(long b=0; b<l; b++) {
+      long bs = s + b*_PARSE_BSIZE, be = min(bs + _PARSE_BSIZE, e);
+      long k = counts[b], i = bs;
+      //a token crossing the block boundary belongs to the previous block
+      if (i > s && !isSpace(S[i-1])) while (i < be && !isSpace(S[i])) i++;
+      while ((i = skipSpace(S, i, be)) < be) {
+        long val;
+        i = parseLong(S, i, e, val);
+        store(k++, val);
+      }
     }
-    S.A = bytes;
-    W = stringToWords(S.A, S.n);
-  } else {
-    _seq<char> S = readStringFromFile(fname);
-    W = stringToWords(S.A, S.n);
   }
+  free(counts);
+  return total;
+}
+
+// Builds the in-edges of a directed graph whose out-edges are set in v
+// by sorting the edges on target, and sets the in-degrees and
+// in-neighbors of v (including the end marker v[n]). offsets[i] is the
+// position of the out-edges of vertex i. Returns the in-edge array
+// (with the weights if WEIGHTED), which is owned by the caller.
+template <class vertex>
+void* buildInEdges(vertex* v, long n, long m, uintT* offsets) {
+  uintT* tOffsets = newA(uintT,n);
+  {parallel_for(long i=0;i<n;i++) tOffsets[i] = INT_T_MAX;}
 #ifndef WEIGHTED
-  if (W.Strings[0] != (string) "AdjacencyGraph") {
+  intPair* temp = newA(intPair,m);
 #else
-  if (W.Strings[0] != (string) "WeightedAdjacencyGraph") {
+  intTriple* temp = newA(intTriple,m);
 #endif
-    cout << "Bad input file" << endl;
-    abort();
-  }
-
-  long len = W.m -1;
-  long n = atol(W.Strings[1]);
-  long m = atol(W.Strings[2]);
+  {parallel_for(long i=0;i<n;i++){
+    uintT o = offsets[i];
+    for(uintT j=0;j<v[i].getOutDegree();j++){
 #ifndef WEIGHTED
-  if (len != n + m + 2) {
+      temp[o+j] = make_pair(v[i].getOutNeighbor(j),i);
 #else
-  if (len != n + 2*m + 2) {
+      temp[o+j] = make_pair(v[i].getOutNeighbor(j),make_pair(i,v[i].getOutWeight(j)));
 #endif
-    cout << "Bad input file" << endl;
-    abort();
-  }
+    }
+    }}
 
-  uintT* offsets = newA(uintT,n);
 #ifndef WEIGHTED
-  uintE* edges = newA(uintE,m);
+#ifndef LOWMEM
+  intSort::iSort(temp,m,n+1,getFirst<uintE>());
+#else
+  quickSort(temp,m,pairFirstCmp<uintE>());
+#endif
+#else
+#ifndef LOWMEM
+  intSort::iSort(temp,m,n+1,getFirst<intPair>());
 #else
-  intE* edges = newA(intE,2*m);
+  quickSort(temp,m,pairFirstCmp<intPair>());
+#endif
 #endif
 
-  {parallel_for(long i=0; i < n; i++) offsets[i] = atol(W.Strings[i + 3]);}
-  {parallel_for(long i=0; i<m; i++) {
+  tOffsets[temp[0].first] = 0;
 #ifndef WEIGHTED
-      edges[i] = atol(W.Strings[i+n+3]);
+  uintE* inEdges = newBigA(uintE,m);
+  inEdges[0] = temp[0].second;
 #else
-      edges[2*i] = atol(W.Strings[i+n+3]);
-      edges[2*i+1] = atol(W.Strings[i+n+m+3]);
+  void* inEdges = newWeightedEdges(m);
+  setWeightedEdge(inEdges,m,0,temp[0].second.first,temp[0].second.second);
 #endif
-    }}
-  //W.del(); // to deal with performance bug in malloc
-
-  vertex* v = newA(vertex,n);
-
-  {parallel_for (uintT i=0; i < n; i++) {
-    uintT o = offsets[i];
-    uintT l = ((i == n-1) ? m : offsets[i+1])-offsets[i];
-    v[i].setOutDegree(l);
+  {parallel_for(long i=1;i<m;i++) {
 #ifndef WEIGHTED
-    v[i].setOutNeighbors(edges+o);
+    inEdges[i] = temp[i].second;
 #else
-    v[i].setOutNeighbors(edges+2*o);
+    setWeightedEdge(inEdges,m,i,temp[i].second.first,temp[i].second.second);
 #endif
+    if(temp[i].first != temp[i-1].first) {
+      tOffsets[temp[i].first] = i;
+    }
     }}
 
-  if(!isSymmetric) {
-    uintT* tOffsets = newA(uintT,n);
-    {parallel_for(long i=0;i<n;i++) tOffsets[i] = INT_T_MAX;}
+  free(temp);
+
+  //fill in offsets of degree 0 vertices by taking closest non-zero
+  //offset to the right
+  sequence::scanIBack(tOffsets,tOffsets,n,minF<uintT>(),(uintT)m);
+
+  {parallel_for(long i=0;i<n;i++){
+    uintT o = tOffsets[i];
+    uintT l = ((i == n-1) ? m : tOffsets[i+1])-tOffsets[i];
+    v[i].setInDegree(l);
 #ifndef WEIGHTED
-    intPair* temp = newA(intPair,m);
+    v[i].setInNeighbors(inEdges+o);
 #else
-    intTriple* temp = newA(intTriple,m);
+    setInEdges(v[i],inEdges,m,o);
 #endif
-    {parallel_for(long i=0;i<n;i++){
-      uintT o = offsets[i];
-      for(uintT j=0;j<v[i].getOutDegree();j++){
+    }}
 #ifndef WEIGHTED
-	temp[o+j] = make_pair(v[i].getOutNeighbor(j),i);
+  v[n].setInNeighbors(inEdges+m);
 #else
-	temp[o+j] = make_pair(v[i].getOutNeighbor(j),make_pair(i,v[i].getOutWeight(j)));
+  setInEdges(v[n],inEdges,m,m);
 #endif
-      }
-      }}
-    free(offsets);
 
+  free(tOffsets);
+  return inEdges;
+}
+
+template <class vertex>
+graph<vertex> readGraphFromFile(char* fname, bool isSymmetric, bool mmap) {
+  //the parser does not mutate the text, so a mapped file is used in place
+  _seq<char> S = mmap ? mmapStringFromFile(fname) : readStringFromFile(fname);
+  char* str = S.A;
+  long len = S.n;
+  long start = skipSpace(str, 0, len), end = start;
+  while (end < len && !isSpace(str[end])) end++;
 #ifndef WEIGHTED
-#ifndef LOWMEM
-    intSort::iSort(temp,m,n+1,getFirst<uintE>());
+  if (string(str+start, end-start) != "AdjacencyGraph") {
 #else
-    quickSort(temp,m,pairFirstCmp<uintE>());
-#endif
-#else
-#ifndef LOWMEM
-    intSort::iSort(temp,m,n+1,getFirst<intPair>());
-#else
-    quickSort(temp,m,pairFirstCmp<intPair>());
-#endif
+  if (string(str+start, end-start) != "WeightedAdjacencyGraph") {
 #endif
+    cout << "Bad input file" << endl;
+    abort();
+  }
+
+  long n, m;
+  end = parseLong(str, skipSpace(str, end, len), len, n);
+  end = parseLong(str, skipSpace(str, end, len), len, m);
+  checkWidths(n,m);
 
-    tOffsets[temp[0].first] = 0;
+  uintT* offsets = newA(uintT,n);
 #ifndef WEIGHTED
-    uintE* inEdges = newA(uintE,m);
-    inEdges[0] = temp[0].second;
+  uintE* edges = newBigA(uintE,m);
+  long expected = n + m;
 #else
-    intE* inEdges = newA(intE,2*m);
-    inEdges[0] = temp[0].second.first;
-    inEdges[1] = temp[0].second.second;
+  void* edges = newWeightedEdges(m);
+  long expected = n + 2*m;
 #endif
-    {parallel_for(long i=1;i<m;i++) {
+
+  long len2 = parseIntegers(str, end, len, expected, [&] (long k, long val) {
+      if (k < n) offsets[k] = val;
 #ifndef WEIGHTED
-      inEdges[i] = temp[i].second;
+      else edges[k-n] = val;
+#elif defined(SOA)
+      else if (k < n+m) ((uintE*) edges)[k-n] = val;
+      else ((weightT*) ((uintE*) edges + m))[k-n-m] = toWeight(val);
 #else
-      inEdges[2*i] = temp[i].second.first;
-      inEdges[2*i+1] = temp[i].second.second;
+      else if (k < n+m) ((intE*) edges)[2*(k-n)] = val;
+      else ((intE*) edges)[2*(k-n-m)+1] = val;
 #endif
-      if(temp[i].first != temp[i-1].first) {
-	tOffsets[temp[i].first] = i;
-      }
-      }}
-
-    free(temp);
+    });
+  if (len2 != expected) {
+    cout << "Bad input file" << endl;
+    abort();
+  }
+  releaseStringFromFile(S, mmap);
 
-    //fill in offsets of degree 0 vertices by taking closest non-zero
-    //offset to the right
-    sequence::scanIBack(tOffsets,tOffsets,n,minF<uintT>(),(uintT)m);
+  //v[n] marks the end of the edges, from which the CSR layout
+  //(csrVertex.h) computes the degree of the last vertex
+  vertex* v = newBigA(vertex,n+1);
 
-    {parallel_for(long i=0;i<n;i++){
-      uintT o = tOffsets[i];
-      uintT l = ((i == n-1) ? m : tOffsets[i+1])-tOffsets[i];
-      v[i].setInDegree(l);
+  {parallel_for (uintT i=0; i < n; i++) {
+    uintT o = offsets[i];
+    uintT l = ((i == n-1) ? m : offsets[i+1])-offsets[i];
+    v[i].setOutDegree(l);
 #ifndef WEIGHTED
-      v[i].setInNeighbors(inEdges+o);
+    v[i].setOutNeighbors(edges+o);
 #else
-      v[i].setInNeighbors(inEdges+2*o);
+    setOutEdges(v[i],edges,m,o);
+#endif
+    }}
+#ifndef WEIGHTED
+  v[n].setOutNeighbors(edges+m);
+#else
+  setOutEdges(v[n],edges,m,m);
 #endif
-      }}
 
-    free(tOffsets);
+  if(!isSymmetric) {
+    void* inEdges = buildInEdges(v,n,m,offsets);
+    free(offsets);
     Uncompressed_Mem<vertex>* mem = new Uncompressed_Mem<vertex>(v,n,m,edges,inEdges);
     return graph<vertex>(v,n,m,mem);
   }
@@ -316,62 +473,73 @@ graph<vertex> readGraphFromFile(char* fname, bool isSymmetric, bool mmap) {
 }
 
 template <class vertex>
-graph<vertex> readGraphFromBinary(char* iFile, bool isSymmetric) {
+graph<vertex> readGraphFromBinary(char* iFile, bool isSymmetric, bool mmap) {
   char* config = (char*) ".config";
   char* adj = (char*) ".adj";
   char* idx = (char*) ".idx";
+  char* tadj = (char*) ".tadj";
+  char* tidx = (char*) ".tidx";
   char configFile[strlen(iFile)+strlen(config)+1];
   char adjFile[strlen(iFile)+strlen(adj)+1];
   char idxFile[strlen(iFile)+strlen(idx)+1];
-  *configFile = *adjFile = *idxFile = '\0';
+  char tadjFile[strlen(iFile)+strlen(tadj)+1];
+  char tidxFile[strlen(iFile)+strlen(tidx)+1];
+  *configFile = *adjFile = *idxFile = *tadjFile = *tidxFile = '\0';
   strcat(configFile,iFile);
   strcat(adjFile,iFile);
   strcat(idxFile,iFile);
+  strcat(tadjFile,iFile);
+  strcat(tidxFile,iFile);
   strcat(configFile,config);
   strcat(adjFile,adj);
   strcat(idxFile,idx);
+  strcat(tadjFile,tadj);
+  strcat(tidxFile,tidx);
 
   ifstream in(configFile, ifstream::in);
   long n;
   in >> n;
   in.close();
 
-  ifstream in2(adjFile,ifstream::in | ios::binary); //stored as uints
-  in2.seekg(0, ios::end);
-  long size = in2.tellg();
-  in2.seekg(0);
+  //with mmap, the edge array points directly into a read-only mapping
+  //of the .adj file instead of being copied into memory. The IDs are
+  //stored as 32-bit uints, so this needs uintE to be 32 bits (no
+  //EDGELONG); otherwise they are widened into a new array.
+  _seq<char> adjData = mmap ? mmapStringFromFile(adjFile) : readStringFromFile(adjFile);
+  long size = adjData.n; //stored as uints
 #ifdef WEIGHTED
   long m = size/(2*sizeof(uint));
 #else
   long m = size/sizeof(uint);
 #endif
-  char* s = (char *) malloc(size);
-  in2.read(s,size);
-  in2.close();
-  uintE* edges = (uintE*) s;
+  checkWidths(n,m);
+  bool idsInPlace = sizeof(uintE) == sizeof(uint);
+#ifndef WEIGHTED
+  void* wideEdges;
+  uintE* edges = widthArray<uintE>(adjData.A, m, sizeof(uint), wideEdges);
+  if (!idsInPlace) releaseStringFromFile(adjData, mmap);
+#endif
 
-  ifstream in3(idxFile,ifstream::in | ios::binary); //stored as longs
-  in3.seekg(0, ios::end);
-  size = in3.tellg();
-  in3.seekg(0);
-  if(n+1 != size/sizeof(intT)) { 
+  //the offsets are stored as intT of the build that wrote them, so
+  //both 32- and 64-bit offsets are accepted
+  _seq<char> idxData = mmap ? mmapStringFromFile(idxFile) : readStringFromFile(idxFile);
+  size = idxData.n;
+  if(size != (n+1)*4 && size != (n+1)*8) {
     cout << n << " " << size << " " << sizeof(intT) << " " << size/sizeof(intT) << " " << size/8 << std::endl;
     cout << "File size wrong\n"; abort(); 
   }
+  void* wideOffsets;
+  uintT* offsets = widthArray<uintT>(idxData.A, n+1, size/(n+1), wideOffsets);
 
-  char* t = (char *) malloc(size);
-  in3.read(t,size);
-  in3.close();
-  uintT* offsets = (uintT*) t;
-
-  vertex* v = newA(vertex,n);
+  vertex* v = newBigA(vertex,n+1); //v[n] marks the end of the edges
 #ifdef WEIGHTED
-  intE* edgesAndWeights = newA(intE,2*m);
-  {parallel_for(long i=0;i<m;i++) {
-    edgesAndWeights[2*i] = edges[i];
-    edgesAndWeights[2*i+1] = edges[i+m];
-    }}
-  //free(edges);
+  uint* stored = (uint*) adjData.A;
+  void* edgesAndWeights = newWeightedEdges(m);
+  {parallel_for(long i=0;i<m;i++)
+      setWeightedEdge(edgesAndWeights,m,i,stored[i],toWeight((int) stored[i+m]));}
+  //weights are converted to weightT (and interleaved unless SOA), so
+  //the file cannot be used in place
+  releaseStringFromFile(adjData, mmap);
 #endif
   {parallel_for(long i=0;i<n;i++) {
     uintT o = offsets[i];
@@ -381,78 +549,84 @@ graph<vertex> readGraphFromBinary(char* iFile, bool isSymmetric) {
 #ifndef WEIGHTED
       v[i].setOutNeighbors((uintE*)edges+o);
 #else
-      v[i].setOutNeighbors(edgesAndWeights+2*o);
+      setOutEdges(v[i],edgesAndWeights,m,o);
 #endif
     }}
-
-  if(!isSymmetric) {
-    uintT* tOffsets = newA(uintT,n);
-    {parallel_for(long i=0;i<n;i++) tOffsets[i] = INT_T_MAX;}
-#ifndef WEIGHTED
-    intPair* temp = newA(intPair,m);
-#else
-    intTriple* temp = newA(intTriple,m);
-#endif
-    {parallel_for(intT i=0;i<n;i++){
-      uintT o = offsets[i];
-      for(uintT j=0;j<v[i].getOutDegree();j++){
 #ifndef WEIGHTED
-	temp[o+j] = make_pair(v[i].getOutNeighbor(j),i);
+  v[n].setOutNeighbors((uintE*)edges+m);
 #else
-	temp[o+j] = make_pair(v[i].getOutNeighbor(j),make_pair(i,v[i].getOutWeight(j)));
+  setOutEdges(v[n],edgesAndWeights,m,m);
 #endif
-      }
-      }}
-    free(offsets);
+
+  //use the persisted transpose written by utils/binaryAddTranspose if
+  //it exists instead of sorting the edges to build the in-edges
+  if(!isSymmetric && fileExists(tadjFile) && fileExists(tidxFile)) {
+    releaseStringFromFile(idxData, mmap);
+    if (wideOffsets != NULL) free(wideOffsets);
+    _seq<char> tadjData = mmap ? mmapStringFromFile(tadjFile) : readStringFromFile(tadjFile);
+    _seq<char> tidxData = mmap ? mmapStringFromFile(tidxFile) : readStringFromFile(tidxFile);
+    if(tadjData.n != adjData.n ||
+       (tidxData.n != (n+1)*4 && tidxData.n != (n+1)*8)) {
+      cout << "Transpose file size wrong\n"; abort();
+    }
+    void* wideTOffsets;
+    uintT* tOffsets = widthArray<uintT>(tidxData.A, n+1, tidxData.n/(n+1), wideTOffsets);
 #ifndef WEIGHTED
-#ifndef LOWMEM
-    intSort::iSort(temp,m,n+1,getFirst<uintE>());
-#else
-    quickSort(temp,m,pairFirstCmp<uintE>());
-#endif
-#else
-#ifndef LOWMEM
-    intSort::iSort(temp,m,n+1,getFirst<intPair>());
+    void* wideInEdges;
+    uintE* inEdges = widthArray<uintE>(tadjData.A, m, sizeof(uint), wideInEdges);
+    if (!idsInPlace) releaseStringFromFile(tadjData, mmap);
 #else
-    quickSort(temp,m,pairFirstCmp<intPair>());
+    uint* inStored = (uint*) tadjData.A;
+    void* inEdges = newWeightedEdges(m);
+    {parallel_for(long i=0;i<m;i++)
+        setWeightedEdge(inEdges,m,i,inStored[i],toWeight((int) inStored[i+m]));}
+    releaseStringFromFile(tadjData, mmap);
 #endif
-#endif
-    tOffsets[temp[0].first] = 0;
+    {parallel_for(long i=0;i<n;i++){
+      uintT o = tOffsets[i];
+      uintT l = tOffsets[i+1]-tOffsets[i];
+      v[i].setInDegree(l);
 #ifndef WEIGHTED
-    uintE* inEdges = newA(uintE,m);
-    inEdges[0] = temp[0].second;
+      v[i].setInNeighbors(inEdges+o);
 #else
-    intE* inEdges = newA(intE,2*m);
-    inEdges[0] = temp[0].second.first;
-    inEdges[1] = temp[0].second.second;
+      setInEdges(v[i],inEdges,m,o);
 #endif
-    {parallel_for(long i=1;i<m;i++) {
+      }}
 #ifndef WEIGHTED
-      inEdges[i] = temp[i].second;
+    v[n].setInNeighbors(inEdges+m);
 #else
-      inEdges[2*i] = temp[i].second.first;
-      inEdges[2*i+1] = temp[i].second.second;
+    setInEdges(v[n],inEdges,m,m);
 #endif
-      if(temp[i].first != temp[i-1].first) {
-	tOffsets[temp[i].first] = i;
-      }
-      }}
-    free(temp);
-    //fill in offsets of degree 0 vertices by taking closest non-zero
-    //offset to the right
-    sequence::scanIBack(tOffsets,tOffsets,n,minF<uintT>(),(uintT)m);
-    {parallel_for(long i=0;i<n;i++){
-      uintT o = tOffsets[i];
-      uintT l = ((i == n-1) ? m : tOffsets[i+1])-tOffsets[i];
-      v[i].setInDegree(l);
+    releaseStringFromFile(tidxData, mmap);
+    if (wideTOffsets != NULL) free(wideTOffsets);
 #ifndef WEIGHTED
-      v[i].setInNeighbors((uintE*)inEdges+o);
+    if (mmap && idsInPlace) {
+      Mmapped_Mem<vertex>* mem = new Mmapped_Mem<vertex>(v,n,m,adjData.A,adjData.n,tadjData.A,tadjData.n);
+      graph<vertex> G(v,n,m,mem);
+      G.readOnly = true;
+      G.addEdgeFile(adjFile,adjData.A,adjData.n);
+      G.addEdgeFile(tadjFile,tadjData.A,tadjData.n);
+      return G;
+    }
+    Uncompressed_Mem<vertex>* mem = new Uncompressed_Mem<vertex>(v,n,m,edges,inEdges);
+    return graph<vertex>(v,n,m,mem);
 #else
-      v[i].setInNeighbors((intE*)(inEdges+2*o));
+    Uncompressed_Mem<vertex>* mem = new Uncompressed_Mem<vertex>(v,n,m,edgesAndWeights,inEdges);
+    return graph<vertex>(v,n,m,mem);
 #endif
-      }}
-    free(tOffsets);
+  }
+  if(!isSymmetric) {
+    void* inEdges = buildInEdges(v,n,m,offsets);
+    releaseStringFromFile(idxData, mmap);
+    if (wideOffsets != NULL) free(wideOffsets);
 #ifndef WEIGHTED
+    if (mmap && idsInPlace) {
+      Mmapped_Mem<vertex>* mem = new Mmapped_Mem<vertex>(v,n,m,adjData.A,adjData.n,inEdges);
+      graph<vertex> G(v,n,m,mem);
+      G.readOnly = true;
+      G.addEdgeFile(adjFile,adjData.A,adjData.n);
+      return G;
+    }
     Uncompressed_Mem<vertex>* mem = new Uncompressed_Mem<vertex>(v,n,m,edges,inEdges);
     return graph<vertex>(v,n,m,mem);
 #else
@@ -460,8 +634,16 @@ graph<vertex> readGraphFromBinary(char* iFile, bool isSymmetric) {
     return graph<vertex>(v,n,m,mem);
 #endif
   }
-  free(offsets);
+  releaseStringFromFile(idxData, mmap);
+  if (wideOffsets != NULL) free(wideOffsets);
 #ifndef WEIGHTED
+  if (mmap && idsInPlace) {
+    Mmapped_Mem<vertex>* mem = new Mmapped_Mem<vertex>(v,n,m,adjData.A,adjData.n);
+    graph<vertex> G(v,n,m,mem);
+    G.readOnly = true;
+    G.addEdgeFile(adjFile,adjData.A,adjData.n);
+    return G;
+  }
   Uncompressed_Mem<vertex>* mem = new Uncompressed_Mem<vertex>(v,n,m,edges);
   return graph<vertex>(v,n,m,mem);
 #else
@@ -470,34 +652,207 @@ graph<vertex> readGraphFromBinary(char* iFile, bool isSymmetric) {
 #endif
 }
 
+// Sets the vertex permutation of G if the container file has one (the
+// graph was relabeled by utils/reorderGraph).
+template <class vertex>
+void readPermutation(graph<vertex>& G, const containerFile& C) {
+  if (!C.has(SEC_PERMUTATION)) return;
+  if ((long) C.count(SEC_PERMUTATION) != G.n) {
+    cout << "Container file permutation has the wrong size" << endl;
+    abort();
+  }
+  G.setPermutation(containerCopy<uintE>(C,SEC_PERMUTATION));
+}
+
+// Loads a graph from a graphContainer file. With mmap the file is mapped
+// and the offsets and edges are used in place when their widths match
+// intT and uintE; otherwise (or to store the weights) they are
+// converted into new arrays. The stored in-edges are used for directed
+// graphs if the file has them, and built by sorting otherwise.
+template <class vertex>
+graph<vertex> readGraphFromContainer(char* iFile, bool isSymmetric, bool mmap) {
+  containerFile C = openContainer(iFile, mmap);
+  long n = C.header->n, m = C.header->m;
+  checkWidths(n,m);
+  if (!C.has(SEC_OUT_OFFSETS) || !C.has(SEC_OUT_EDGES) ||
+      C.count(SEC_OUT_OFFSETS) != n+1 || C.count(SEC_OUT_EDGES) != m) {
+    cout << "Container file has no uncompressed graph" << endl;
+    abort();
+  }
+#ifdef WEIGHTED
+  if (!C.weighted()) {
+    cout << "Container file is not weighted" << endl;
+    abort();
+  }
+#endif
+  bool hasInEdges = C.has(SEC_IN_OFFSETS) && C.has(SEC_IN_EDGES);
+  if (!isSymmetric && C.symmetric()) hasInEdges = false;
+
+  void* ownedOffsets, *ownedEdges;
+  uintT* offsets = containerArray<uintT>(C, SEC_OUT_OFFSETS, ownedOffsets);
+#ifndef WEIGHTED
+  uintE* edges = containerArray<uintE>(C, SEC_OUT_EDGES, ownedEdges);
+#else
+  void* ownedWeights;
+  uintE* targets = containerArray<uintE>(C, SEC_OUT_EDGES, ownedEdges);
+  intE* weights = containerArray<intE>(C, SEC_OUT_WEIGHTS, ownedWeights);
+  void* edges = newWeightedEdges(m);
+  {parallel_for(long i=0;i<m;i++)
+      setWeightedEdge(edges,m,i,targets[i],toWeight(weights[i]));}
+  if (ownedEdges != NULL) free(ownedEdges);
+  if (ownedWeights != NULL) free(ownedWeights);
+  ownedEdges = edges;
+#endif
+
+  vertex* v = newBigA(vertex,n+1); //v[n] marks the end of the edges
+  {parallel_for(long i=0;i<n;i++) {
+    uintT o = offsets[i];
+    v[i].setOutDegree(offsets[i+1]-o);
+#ifndef WEIGHTED
+    v[i].setOutNeighbors(edges+o);
+#else
+    setOutEdges(v[i],edges,m,o);
+#endif
+    }}
+#ifndef WEIGHTED
+  v[n].setOutNeighbors(edges+m);
+#else
+  setOutEdges(v[n],edges,m,m);
+#endif
+
+  void* inEdges = NULL;
+  if (!isSymmetric && hasInEdges) {
+    void* ownedInOffsets;
+    uintT* tOffsets = containerArray<uintT>(C, SEC_IN_OFFSETS, ownedInOffsets);
+#ifndef WEIGHTED
+    uintE* in = containerArray<uintE>(C, SEC_IN_EDGES, inEdges);
+#else
+    void* ownedInEdges, *ownedInWeights;
+    uintE* inTargets = containerArray<uintE>(C, SEC_IN_EDGES, ownedInEdges);
+    intE* inWeights = containerArray<intE>(C, SEC_IN_WEIGHTS, ownedInWeights);
+    void* in = newWeightedEdges(m);
+    {parallel_for(long i=0;i<m;i++)
+        setWeightedEdge(in,m,i,inTargets[i],toWeight(inWeights[i]));}
+    if (ownedInEdges != NULL) free(ownedInEdges);
+    if (ownedInWeights != NULL) free(ownedInWeights);
+    inEdges = in;
+#endif
+    {parallel_for(long i=0;i<n;i++) {
+      uintT o = tOffsets[i];
+      v[i].setInDegree(tOffsets[i+1]-o);
+#ifndef WEIGHTED
+      v[i].setInNeighbors(in+o);
+#else
+      setInEdges(v[i],in,m,o);
+#endif
+      }}
+#ifndef WEIGHTED
+    v[n].setInNeighbors(in+m);
+#else
+    setInEdges(v[n],in,m,m);
+#endif
+    if (ownedInOffsets != NULL) free(ownedInOffsets);
+  } else if (!isSymmetric) {
+    inEdges = buildInEdges(v,n,m,offsets);
+  }
+  if (ownedOffsets != NULL) free(ownedOffsets);
+
+  Container_Mem<vertex>* mem = new Container_Mem<vertex>(v,C,ownedEdges,inEdges);
+  graph<vertex> G(v,n,m,mem);
+  G.readOnly = C.mapped && ownedEdges == NULL;
+  if (C.mapped) G.addEdgeFile(iFile,C.base,C.size);
+  readPermutation(G,C);
+  return G;
+}
+
 template <class vertex>
 graph<vertex> readGraph(char* iFile, bool compressed, bool symmetric, bool binary, bool mmap) {
-  if(binary) return readGraphFromBinary<vertex>(iFile,symmetric);
+  ioScope scope("load");
+  scope.mode = mmap ? "mmap" : "read";
+  if(isContainerFile(iFile)) return readGraphFromContainer<vertex>(iFile,symmetric,mmap);
+  if(binary) return readGraphFromBinary<vertex>(iFile,symmetric,mmap);
   else return readGraphFromFile<vertex>(iFile,symmetric,mmap);
 }
 
+// Loads a compressed graph from the compressed sections of a
+// graphContainer file, in place from the mapping if mmap is set.
+template <class vertex>
+graph<vertex> readCompressedGraphFromContainer(char* fname, bool isSymmetric, bool mmap) {
+  containerFile C = openContainer(fname, mmap);
+  long n = C.header->n, m = C.header->m;
+  checkWidths(n,m);
+  if (!C.has(SEC_COMPRESSED_OUT_OFFSETS) || !C.has(SEC_COMPRESSED_OUT_DEGREES) ||
+      !C.has(SEC_COMPRESSED_OUT_EDGES)) {
+    cout << "Container file has no compressed graph" << endl;
+    abort();
+  }
+  if ((C.header->flags & CONTAINER_SCHEME_MASK) != CONTAINER_SCHEME) {
+    cout << "Container file was encoded with a different compression scheme" << endl;
+    abort();
+  }
+  bool asymmetric = sizeof(vertex) == sizeof(compressedAsymmetricVertex);
+  if (asymmetric && !C.symmetric() && !C.has(SEC_COMPRESSED_IN_EDGES)) {
+    cout << "Container file has no compressed in-edges" << endl;
+    abort();
+  }
+  void* ownedOffsets, *ownedDegrees, *ownedInOffsets = NULL, *ownedInDegrees = NULL;
+  uintT* offsets = containerArray<uintT>(C, SEC_COMPRESSED_OUT_OFFSETS, ownedOffsets);
+  uintE* Degrees = containerArray<uintE>(C, SEC_COMPRESSED_OUT_DEGREES, ownedDegrees);
+  uchar* edges = (uchar*) C.get(SEC_COMPRESSED_OUT_EDGES);
+  uintT* inOffsets = offsets;
+  uintE* inDegrees = Degrees;
+  uchar* inEdges = edges;
+  if (!C.symmetric()) {
+    inOffsets = containerArray<uintT>(C, SEC_COMPRESSED_IN_OFFSETS, ownedInOffsets);
+    inDegrees = containerArray<uintE>(C, SEC_COMPRESSED_IN_DEGREES, ownedInDegrees);
+    inEdges = (uchar*) C.get(SEC_COMPRESSED_IN_EDGES);
+  }
+
+  vertex *V = newBigA(vertex,n);
+  parallel_for(long i=0;i<n;i++) {
+    V[i].setOutDegree(Degrees[i]);
+    V[i].setOutNeighbors(edges+offsets[i]);
+  }
+  if(asymmetric) {
+    parallel_for(long i=0;i<n;i++) {
+      V[i].setInDegree(inDegrees[i]);
+      V[i].setInNeighbors(inEdges+inOffsets[i]);
+    }
+  }
+  if (ownedOffsets != NULL) free(ownedOffsets);
+  if (ownedDegrees != NULL) free(ownedDegrees);
+  if (ownedInOffsets != NULL) free(ownedInOffsets);
+  if (ownedInDegrees != NULL) free(ownedInDegrees);
+
+  Container_Mem<vertex>* mem = new Container_Mem<vertex>(V,C);
+  graph<vertex> G(V,n,m,mem);
+  G.readOnly = C.mapped;
+  if (C.mapped) G.addEdgeFile(fname,C.base,C.size);
+  readPermutation(G,C);
+  return G;
+}
+
 template <class vertex>
 graph<vertex> readCompressedGraph(char* fname, bool isSymmetric, bool mmap) {
+  ioScope scope("load");
+  scope.mode = mmap ? "mmap" : "read";
+  if (isContainerFile(fname))
+    return readCompressedGraphFromContainer<vertex>(fname,isSymmetric,mmap);
   char* s;
+  size_t mappedSize = 0;
   if (mmap) {
+    //the decoders only read the edges, so they are used in place from
+    //the read-only mapping
     _seq<char> S = mmapStringFromFile(fname);
-    // Cannot mutate graph unless we copy.
-    char *bytes = newA(char, S.n);
-    parallel_for(size_t i=0; i<S.n; i++) {
-      bytes[i] = S.A[i];
-    }
-    if (munmap(S.A, S.n) == -1) {
-      perror("munmap");
-      exit(-1);
-    }
-    s = bytes;
+    s = S.A;
+    mappedSize = S.n;
   } else {
     ifstream in(fname,ifstream::in |ios::binary);
     in.seekg(0,ios::end);
     long size = in.tellg();
     in.seekg(0);
     cout << "size = " << size << endl;
-    s = (char*) malloc(size);
+    s = (char*) bigAlloc(size);
     in.read(s,size);
     in.close();
   }
@@ -506,6 +861,7 @@ graph<vertex> readCompressedGraph(char* fname, bool isSymmetric, bool mmap) {
   long n = sizes[0], m = sizes[1], totalSpace = sizes[2];
 
   cout << "n = "<<n<<" m = "<<m<<" totalSpace = "<<totalSpace<<endl;
+  checkWidths(n,m);
   cout << "reading file..."<<endl;
 
   uintT* offsets = (uintT*) (s+3*sizeof(long));
@@ -536,7 +892,7 @@ graph<vertex> readCompressedGraph(char* fname, bool isSymmetric, bool mmap) {
   }
 
 
-  vertex *V = newA(vertex,n);
+  vertex *V = newBigA(vertex,n);
   parallel_for(long i=0;i<n;i++) {
     long o = offsets[i];
     uintT d = Degrees[i];
@@ -554,8 +910,10 @@ graph<vertex> readCompressedGraph(char* fname, bool isSymmetric, bool mmap) {
   }
 
   cout << "creating graph..."<<endl;
-  Compressed_Mem<vertex>* mem = new Compressed_Mem<vertex>(V, s);
+  Compressed_Mem<vertex>* mem = new Compressed_Mem<vertex>(V, s, mappedSize);
 
   graph<vertex> G(V,n,m,mem);
+  G.readOnly = mmap;
+  if (mmap) G.addEdgeFile(fname,s,mappedSize);
   return G;
 }
@@ -0,0 +1,190 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Allocator for graph-sized arrays (vertex and edge arrays of the
+// loaded graph and vertexSubset buffers), selected at runtime with
+// -alloc <mode>:
+//   malloc    plain malloc, as newA (default)
+//   huge      2MB-aligned anonymous mmap with MADV_HUGEPAGE, faulted in
+//             by a parallel first touch so that pages are spread over
+//             the threads' memory nodes
+//   populate  like huge, but prefaulted by the kernel (MADV_POPULATE_WRITE,
+//             or MAP_POPULATE where it is not available)
+// Allocations smaller than BIG_ALLOC_MIN always use malloc. The mapped
+// regions are kept in a registry, so bigFree() can be called on any
+// pointer and falls back to free() for memory that was not mapped here.
+//
+// The frontier arrays that edgeMap, vertexFilter and the vertexSubset
+// conversions allocate in every iteration come from newPoolA. When
+// freed, these regions are cached (up to BIG_ALLOC_CACHE_BYTES in total)
+// and reused by later newPoolA allocations of at least half their size,
+// so that the frontier arrays do not fault in fresh pages each time. In
+// the malloc mode they are registered once they reach BIG_ALLOC_POOL_MIN
+// bytes (below that malloc reuses freed memory itself), rounded up to a
+// power of two so that frontiers of similar sizes share them. Regions
+// from newBigA, such as the graph's arrays, are released when freed.
+// Memory from newBigA and newPoolA must be released with bigFree.
+#pragma once
+#include <iostream>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <map>
+#include <mutex>
+#include "parallel.h"
+using namespace std;
+
+#define BIG_ALLOC_PAGE (2L<<20) //transparent huge page size
+#define BIG_ALLOC_MIN (1L<<20)
+//largest mmap threshold of malloc
+#define BIG_ALLOC_POOL_MIN (32L<<20)
+//bytes of freed pooled regions kept for reuse
+#ifndef BIG_ALLOC_CACHE_BYTES
+#define BIG_ALLOC_CACHE_BYTES (4L<<30)
+#endif
+
+enum bigAllocMode { ALLOC_MALLOC, ALLOC_HUGE, ALLOC_POPULATE };
+
+//a region of the registry, mapped here or malloced
+struct bigRegion {
+  size_t len;
+  bool mapped;
+  bool pooled; //allocated with newPoolA, cached when freed
+};
+
+struct bigAllocator {
+  bigAllocMode mode;
+  mutex lock;
+  map<char*,bigRegion> regions; //regions in use
+  multimap<size_t,pair<char*,bool>> cached; //freed pooled regions and
+                                            //whether they are mapped,
+                                            //by length
+  size_t cachedBytes;
+
+  bigAllocator() : mode(ALLOC_MALLOC), cachedBytes(0) {}
+
+  //sets the mode from its name, returning false if it is unknown
+  bool setMode(const char* name) {
+    if (strcmp(name,"malloc") == 0) mode = ALLOC_MALLOC;
+    else if (strcmp(name,"huge") == 0) mode = ALLOC_HUGE;
+    else if (strcmp(name,"populate") == 0) mode = ALLOC_POPULATE;
+    else return false;
+    return true;
+  }
+
+  //maps len bytes (a multiple of BIG_ALLOC_PAGE) aligned to BIG_ALLOC_PAGE
+  char* mapRegion(size_t len) {
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifndef MADV_POPULATE_WRITE
+    if (mode == ALLOC_POPULATE) flags |= MAP_POPULATE;
+#endif
+    char* p = (char*) mmap(0, len + BIG_ALLOC_PAGE, PROT_READ | PROT_WRITE,
+                           flags, -1, 0);
+    if (p == MAP_FAILED) {
+      perror("mmap");
+      exit(-1);
+    }
+    char* A = (char*) (((size_t) p + BIG_ALLOC_PAGE - 1) & ~(BIG_ALLOC_PAGE - 1));
+    if (A > p) munmap(p, A - p);
+    if (A + len < p + len + BIG_ALLOC_PAGE)
+      munmap(A + len, p + len + BIG_ALLOC_PAGE - (A + len));
+    //fails harmlessly if the kernel has no transparent huge pages
+    madvise(A, len, MADV_HUGEPAGE);
+    bool touch = mode == ALLOC_HUGE;
+#ifdef MADV_POPULATE_WRITE
+    if (mode == ALLOC_POPULATE && madvise(A, len, MADV_POPULATE_WRITE) != 0)
+      touch = true; //kernel older than 5.14
+#endif
+    if (touch) {
+      long pages = len / 4096;
+      parallel_for(long i=0;i<pages;i++) A[i*4096] = 0;
+    }
+    return A;
+  }
+
+  //pooled allocations are also cached in the malloc mode
+  void* alloc(size_t size, bool pooled = false) {
+    bool mapped = mode != ALLOC_MALLOC && size >= BIG_ALLOC_MIN;
+    if (!mapped && !(pooled && size >= BIG_ALLOC_POOL_MIN)) return malloc(size);
+    size_t len = mapped ? (size + BIG_ALLOC_PAGE - 1) & ~(BIG_ALLOC_PAGE - 1) :
+      (size_t) 1 << (64 - __builtin_clzll(size - 1));
+    char* A = NULL;
+    if (pooled) {
+      lock_guard<mutex> g(lock);
+      //reuse a cached region of the same kind unless it is more than
+      //twice as large
+      auto it = cached.lower_bound(len);
+      while (it != cached.end() && it->first <= 2*len &&
+             it->second.second != mapped) it++;
+      if (it != cached.end() && it->first <= 2*len) {
+        A = it->second.first;
+        regions[A] = {it->first, mapped, true};
+        cachedBytes -= it->first;
+        cached.erase(it);
+      }
+    }
+    if (A != NULL) return A;
+    A = mapped ? mapRegion(len) : (char*) malloc(len);
+    if (A == NULL) return NULL;
+    lock_guard<mutex> g(lock);
+    regions[A] = {len, mapped, pooled};
+    return A;
+  }
+
+  void release(void* p) {
+    if (p == NULL) return;
+    bigRegion r;
+    {
+      lock_guard<mutex> g(lock);
+      map<char*,bigRegion>::iterator it = regions.find((char*) p);
+      if (it == regions.end()) {
+        free(p);
+        return;
+      }
+      r = it->second;
+      regions.erase(it);
+      if (r.pooled && cachedBytes + r.len <= BIG_ALLOC_CACHE_BYTES) {
+        cached.insert(make_pair(r.len, make_pair((char*) p, r.mapped)));
+        cachedBytes += r.len;
+        return;
+      }
+    }
+    if (!r.mapped) free(p);
+    else if (munmap(p, r.len) == -1) {
+      perror("munmap");
+      exit(-1);
+    }
+  }
+};
+
+static bigAllocator _bigAlloc;
+
+inline void* bigAlloc(size_t size, bool pooled = false) {
+  return _bigAlloc.alloc(size, pooled);
+}
+inline void bigFree(void* p) { _bigAlloc.release(p); }
+
+#define newBigA(__E,__n) (__E*) bigAlloc((__n)*sizeof(__E))
+#define newPoolA(__E,__n) (__E*) bigAlloc((__n)*sizeof(__E), true)
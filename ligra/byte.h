@@ -208,7 +208,7 @@ long compressEdge(uchar *start, long curOffset, uintE e) {
 // Alternate implementation of packOutNgh, which does both the decoding and
 // reencoding in one pass of the edges.
 template <class P>
-inline size_t pack(P pred, uchar* edge_start, const uintE &source, const uintE &degree) {
+inline size_t pack(P pred, uchar* edge_start, const uintE &source, const uintT &degree) {
   size_t new_deg = 0;
 
   uintE last_read_edge = source;
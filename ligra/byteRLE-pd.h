@@ -109,7 +109,7 @@ inline uintE eatEdge(uchar* &start) {
 template <class T>
   inline void decode(T t, uchar* edgeStart, const uintE &source, const uintT &degree, const bool par=true) {
   if (degree > 0) {
-    uintE edgesRead = 0;
+    uintT edgesRead = 0;
     long numChunks = 1+(degree-1)/PARALLEL_DEGREE;
     uintE* pOffsets = (uintE*) edgeStart;
     uchar* start = edgeStart + (numChunks-1)*sizeof(uintE);
@@ -463,7 +463,7 @@ int numBytesSigned (intE x) {
 template <class T>
   inline void decodeWgh(T t, uchar* edgeStart, const uintE &source, const uintT &degree, const bool par=true) {
   if (degree > 0) {
-    uintE edgesRead = 0;
+    uintT edgesRead = 0;
     long numChunks = 1+(degree-1)/PARALLEL_DEGREE;
     uintE* pOffsets = (uintE*) edgeStart;
     uchar* start = edgeStart+(numChunks-1)*sizeof(uintE);
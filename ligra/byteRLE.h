@@ -89,7 +89,7 @@ inline intE eatFirstEdge(uchar* &start, uintE source) {
 */
 template <class T>
   inline void decode(T t, uchar* edgeStart, const uintE &source, const uintT &degree, const bool par=true) {
-  uintE edgesRead = 0;
+  uintT edgesRead = 0;
   if (degree > 0) {
     // Eat first edge, which is compressed specially
     uintE startEdge = eatFirstEdge(edgeStart,source);
@@ -367,7 +367,7 @@ int numBytesSigned (intE x) {
 
 template <class T>
   inline void decodeWgh(T t, uchar* edgeStart, const uintE &source, const uintT &degree, const bool par=true) {
-  uintE edgesRead = 0;
+  uintT edgesRead = 0;
   if (degree > 0) {
     // Eat first edge, which is compressed specially
     uintE startEdge = eatFirstEdge(edgeStart,source);
@@ -33,7 +33,7 @@ namespace decode_compressed {
         auto m = f.update(target, src);
         g(src, m);
       }
-      return f.cond(src);
+      return !breakEarly<F>::value || f.cond(src);
     }
 #else
     inline bool srcTarg(const uintE &src, const uintE &target, const intE &weight, const uintT &edgeNumber) {
@@ -41,7 +41,7 @@ namespace decode_compressed {
         auto m = f.update(target, src, weight);
         g(src, m);
       }
-      return f.cond(src);
+      return !breakEarly<F>::value || f.cond(src);
     }
 #endif
   };
@@ -53,7 +53,7 @@ namespace decode_compressed {
   denseForwardT(F &_f, G &_g) : f(_f), g(_g) {}
 #ifndef WEIGHTED
     inline bool srcTarg(const uintE &src, const uintE &target, const uintT &edgeNumber) {
-      if (f.cond(target)) {
+      if (checkCond(f, target)) {
         auto m = f.updateAtomic(src, target);
         g(target, m);
       }
@@ -61,7 +61,7 @@ namespace decode_compressed {
     }
 #else
     inline bool srcTarg(const uintE &src, const uintE &target, const intE &weight, const uintT &edgeNumber) {
-      if (f.cond(target)) {
+      if (checkCond(f, target)) {
         auto m = f.updateAtomic(src, target, weight);
         g(target, m);
       }
@@ -78,7 +78,7 @@ namespace decode_compressed {
   sparseT(F &_f, G &_g, uintT vP, uintT oP) : f(_f), g(_g), v(vP), o(oP) { }
 #ifndef WEIGHTED
     inline bool srcTarg(const uintE &src, const uintE &target, const uintT &edgeNumber) {
-      if (f.cond(target)) {
+      if (checkCond(f, target)) {
         auto m = f.updateAtomic(v, target);
         g(target, o + edgeNumber, m);
       } else {
@@ -87,7 +87,40 @@ namespace decode_compressed {
       return true; }
 #else
     inline bool srcTarg(const uintE &src, const uintE &target, const intE &weight, const uintT &edgeNumber) {
-      if (f.cond(target)) {
+      if (checkCond(f, target)) {
+        auto m = f.updateAtomic(v, target, weight);
+        g(target, o + edgeNumber, m);
+      } else {
+        g(target, o + edgeNumber);
+      }
+      return true; }
+#endif
+  };
+
+  //sparseT for the edges numbered [lo, hi) only, stopping at hi
+  template <class F, class G>
+  struct sparseTRange {
+    uintT v, o, lo, hi;
+    F f;
+    G g;
+  sparseTRange(F &_f, G &_g, uintT vP, uintT oP, uintT _lo, uintT _hi) :
+    f(_f), g(_g), v(vP), o(oP), lo(_lo), hi(_hi) { }
+#ifndef WEIGHTED
+    inline bool srcTarg(const uintE &src, const uintE &target, const uintT &edgeNumber) {
+      if (edgeNumber >= hi) return false;
+      if (edgeNumber < lo) return true;
+      if (checkCond(f, target)) {
+        auto m = f.updateAtomic(v, target);
+        g(target, o + edgeNumber, m);
+      } else {
+        g(target, o + edgeNumber);
+      }
+      return true; }
+#else
+    inline bool srcTarg(const uintE &src, const uintE &target, const intE &weight, const uintT &edgeNumber) {
+      if (edgeNumber >= hi) return false;
+      if (edgeNumber < lo) return true;
+      if (checkCond(f, target)) {
         auto m = f.updateAtomic(v, target, weight);
         g(target, o + edgeNumber, m);
       } else {
@@ -106,7 +139,7 @@ namespace decode_compressed {
   sparseTSeq(F &_f, G &_g, uintT vP, uintT oP, size_t& _k) : f(_f), g(_g), v(vP), o(oP), k(_k) { }
 #ifndef WEIGHTED
     inline bool srcTarg(const uintE &src, const uintE &target, const uintT &edgeNumber) {
-      if (f.cond(target)) {
+      if (checkCond(f, target)) {
         auto m = f.updateAtomic(v, target);
         if (g(target, o + k, m)) {
           k++;
@@ -115,7 +148,7 @@ namespace decode_compressed {
       return true; }
 #else
     inline bool srcTarg(const uintE &src, const uintE &target, const intE &weight, const uintT &edgeNumber) {
-      if (f.cond(target)) {
+      if (checkCond(f, target)) {
         auto m = f.updateAtomic(v, target, weight);
         if (g(target, o + k, m)) {
           k++;
@@ -163,7 +196,6 @@ namespace decode_compressed {
 
   template<class V, class F, class G, class VS>
   inline void decodeInNghBreakEarly(V* v, long i, VS& vertexSubset, F &f, G &g, bool parallel = 0) {
-    uintE d = v->getInDegree();
     uchar *nghArr = v->getInNeighbors();
 #ifdef WEIGHTED
         decodeWgh(denseT<F, G, VS>(f, g, vertexSubset), nghArr, i, v->getInDegree());
@@ -174,7 +206,6 @@ namespace decode_compressed {
 
   template<class V, class F, class G>
   inline void decodeOutNgh(V* v, long i, F &f, G &g) {
-    uintE d = v->getInDegree();
     uchar *nghArr = v->getOutNeighbors();
 #ifdef WEIGHTED
         decodeWgh(denseForwardT<F, G>(f, g), nghArr, i, v->getOutDegree());
@@ -193,6 +224,17 @@ namespace decode_compressed {
 #endif
   }
 
+  //the edges before lo are decoded but skipped
+  template <class V, class F, class G>
+  inline void decodeOutNghSparseRange(V* v, long i, uintT o, uintT lo, uintT hi, F &f, G &g) {
+    uchar *nghArr = v->getOutNeighbors();
+#ifdef WEIGHTED
+    decodeWgh(sparseTRange<F, G>(f, g, i, o, lo, hi), nghArr, i, v->getOutDegree(), false);
+#else
+    decode(sparseTRange<F, G>(f, g, i, o, lo, hi), nghArr, i, v->getOutDegree(), false);
+#endif
+  }
+
   template <class V, class F, class G>
   inline size_t decodeOutNghSparseSeq(V* v, long i, uintT o, F &f, G &g) {
     uchar *nghArr = v->getOutNeighbors();
@@ -296,6 +338,11 @@ struct compressedSymmetricVertex {
     decode_compressed::decodeOutNghSparse<compressedSymmetricVertex, F, G>(this, i, o, f, g);
   }
 
+  template <class F, class G>
+  inline void decodeOutNghSparseRange(long i, uintT o, uintT lo, uintT hi, F &f, G &g) {
+    decode_compressed::decodeOutNghSparseRange<compressedSymmetricVertex, F, G>(this, i, o, lo, hi, f, g);
+  }
+
   template <class F, class G>
   inline size_t decodeOutNghSparseSeq(long i, uintT o, F &f, G &g) {
     return decode_compressed::decodeOutNghSparseSeq<compressedSymmetricVertex, F, G>(this, i, o, f, g);
@@ -358,6 +405,11 @@ struct compressedAsymmetricVertex {
     decode_compressed::decodeOutNghSparse<compressedAsymmetricVertex, F, G>(this, i, o, f, g);
   }
 
+  template <class F, class G>
+  inline void decodeOutNghSparseRange(long i, uintT o, uintT lo, uintT hi, F &f, G &g) {
+    decode_compressed::decodeOutNghSparseRange<compressedAsymmetricVertex, F, G>(this, i, o, lo, hi, f, g);
+  }
+
   template <class F, class G>
   inline size_t decodeOutNghSparseSeq(long i, uintT o, F &f, G &g) {
     return decode_compressed::decodeOutNghSparseSeq<compressedAsymmetricVertex, F, G>(this, i, o, f, g);
@@ -0,0 +1,237 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Offset-based (CSR) layout of uncompressed graphs, used instead of
+// symmetricVertex/asymmetricVertex when compiling with CSR defined. A
+// vertex only holds where its adjacency list starts in the edge array,
+// which is the offsets array in pointer form; its degree is the distance
+// to the start of the next vertex's list, so the vertex array has n+1
+// entries, the last one marking the end of the edges. This takes 8 bytes
+// per vertex and direction instead of a pointer and a degree (16 or 32
+// bytes per vertex).
+//
+// Since the degree is read from the next entry, a vertex must be used in
+// place in the graph's vertex array and never copied. For the same
+// reason the degree cannot be changed, so packEdges is not supported,
+// and the semi-external mode (which stages copies of the frontier's
+// vertices) is disabled.
+#pragma once
+#include <type_traits>
+#include "vertex.h"
+using namespace std;
+
+#if defined(CSR) && defined(WEIGHTED) && defined(SOA)
+#error "the CSR layout keeps the weights interleaved, do not combine it with SOA"
+#endif
+
+struct csrSymmetricVertex {
+#ifndef WEIGHTED
+  uintE* neighbors;
+#else
+  //weights are stored in the entry after the neighbor ID
+  intE* neighbors;
+#endif
+  void del() {}
+#ifndef WEIGHTED
+  uintE* getInNeighbors () { return neighbors; }
+  const uintE* getInNeighbors () const { return neighbors; }
+  uintE* getOutNeighbors () { return neighbors; }
+  const uintE* getOutNeighbors () const { return neighbors; }
+  uintE getInNeighbor(uintT j) const { return neighbors[j]; }
+  uintE getOutNeighbor(uintT j) const { return neighbors[j]; }
+  void setInNeighbor(uintT j, uintE ngh) { neighbors[j] = ngh; }
+  void setOutNeighbor(uintT j, uintE ngh) { neighbors[j] = ngh; }
+  void setInNeighbors(uintE* _i) { neighbors = _i; }
+  void setOutNeighbors(uintE* _i) { neighbors = _i; }
+  uintT getOutDegree() const { return (this+1)->neighbors - neighbors; }
+#else
+  intE* getInNeighbors () { return neighbors; }
+  const intE* getInNeighbors () const { return neighbors; }
+  intE* getOutNeighbors () { return neighbors; }
+  const intE* getOutNeighbors () const { return neighbors; }
+  intE getInNeighbor(intT j) const { return neighbors[2*j]; }
+  intE getOutNeighbor(intT j) const { return neighbors[2*j]; }
+  intE getInWeight(intT j) const { return neighbors[2*j+1]; }
+  intE getOutWeight(intT j) const { return neighbors[2*j+1]; }
+  void setInNeighbor(uintT j, uintE ngh) { neighbors[2*j] = ngh; }
+  void setOutNeighbor(uintT j, uintE ngh) { neighbors[2*j] = ngh; }
+  void setInWeight(uintT j, intE wgh) { neighbors[2*j+1] = wgh; }
+  void setOutWeight(uintT j, intE wgh) { neighbors[2*j+1] = wgh; }
+  void setInNeighbors(intE* _i) { neighbors = _i; }
+  void setOutNeighbors(intE* _i) { neighbors = _i; }
+  uintT getOutDegree() const { return ((this+1)->neighbors - neighbors)/2; }
+#endif
+
+  uintT getInDegree() const { return getOutDegree(); }
+  //the degrees are implied by the next vertex, so the loaders' calls
+  //have nothing to store
+  void setInDegree(uintT _d) {}
+  void setOutDegree(uintT _d) {}
+  void flipEdges() {}
+
+  template <class VS, class F, class G>
+  inline void decodeInNghBreakEarly(long v_id, VS& vertexSubset, F &f, G &g, bool parallel = 0) {
+    decode_uncompressed::decodeInNghBreakEarly<csrSymmetricVertex, F, G, VS>(this, v_id, vertexSubset, f, g, parallel);
+  }
+
+  template <class F, class G>
+  inline void decodeOutNgh(long i, F &f, G& g) {
+     decode_uncompressed::decodeOutNgh<csrSymmetricVertex, F, G>(this, i, f, g);
+  }
+
+  template <class F, class G>
+  inline void decodeOutNghSparse(long i, uintT o, F &f, G &g) {
+    decode_uncompressed::decodeOutNghSparse<csrSymmetricVertex, F>(this, i, o, f, g);
+  }
+
+  template <class F, class G>
+  inline void decodeOutNghSparseRange(long i, uintT o, uintT lo, uintT hi, F &f, G &g) {
+    decode_uncompressed::decodeOutNghSparseRange<csrSymmetricVertex, F>(this, i, o, lo, hi, f, g);
+  }
+
+  template <class F, class G>
+  inline size_t decodeOutNghSparseSeq(long i, uintT o, F &f, G &g) {
+    return decode_uncompressed::decodeOutNghSparseSeq<csrSymmetricVertex, F>(this, i, o, f, g);
+  }
+
+  template <class E, class F, class G>
+  inline void copyOutNgh(long i, uintT o, F& f, G& g) {
+    decode_uncompressed::copyOutNgh<csrSymmetricVertex, E>(this, i, o, f, g);
+  }
+
+  template <class F>
+  inline size_t countOutNgh(long i, F &f) {
+    return decode_uncompressed::countOutNgh<csrSymmetricVertex, F>(this, i, f);
+  }
+
+  template <class F>
+  inline size_t packOutNgh(long i, F &f, bool* bits, uintE* tmp1, uintE* tmp2) {
+    return decode_uncompressed::packOutNgh<csrSymmetricVertex, F>(this, i, f, bits, tmp1);
+  }
+
+};
+
+struct csrAsymmetricVertex {
+#ifndef WEIGHTED
+  uintE* inNeighbors, *outNeighbors;
+#else
+  intE* inNeighbors, *outNeighbors;
+#endif
+  void del() {}
+#ifndef WEIGHTED
+  uintE* getInNeighbors () { return inNeighbors; }
+  const uintE* getInNeighbors () const { return inNeighbors; }
+  uintE* getOutNeighbors () { return outNeighbors; }
+  const uintE* getOutNeighbors () const { return outNeighbors; }
+  uintE getInNeighbor(uintT j) const { return inNeighbors[j]; }
+  uintE getOutNeighbor(uintT j) const { return outNeighbors[j]; }
+  void setInNeighbor(uintT j, uintE ngh) { inNeighbors[j] = ngh; }
+  void setOutNeighbor(uintT j, uintE ngh) { outNeighbors[j] = ngh; }
+  void setInNeighbors(uintE* _i) { inNeighbors = _i; }
+  void setOutNeighbors(uintE* _i) { outNeighbors = _i; }
+  uintT getInDegree() const { return (this+1)->inNeighbors - inNeighbors; }
+  uintT getOutDegree() const { return (this+1)->outNeighbors - outNeighbors; }
+#else
+  intE* getInNeighbors () { return inNeighbors; }
+  const intE* getInNeighbors () const { return inNeighbors; }
+  intE* getOutNeighbors () { return outNeighbors; }
+  const intE* getOutNeighbors () const { return outNeighbors; }
+  intE getInNeighbor(uintT j) const { return inNeighbors[2*j]; }
+  intE getOutNeighbor(uintT j) const { return outNeighbors[2*j]; }
+  intE getInWeight(uintT j) const { return inNeighbors[2*j+1]; }
+  intE getOutWeight(uintT j) const { return outNeighbors[2*j+1]; }
+  void setInNeighbor(uintT j, uintE ngh) { inNeighbors[2*j] = ngh; }
+  void setOutNeighbor(uintT j, uintE ngh) { outNeighbors[2*j] = ngh; }
+  void setInWeight(uintT j, uintE wgh) { inNeighbors[2*j+1] = wgh; }
+  void setOutWeight(uintT j, uintE wgh) { outNeighbors[2*j+1] = wgh; }
+  void setInNeighbors(intE* _i) { inNeighbors = _i; }
+  void setOutNeighbors(intE* _i) { outNeighbors = _i; }
+  uintT getInDegree() const { return ((this+1)->inNeighbors - inNeighbors)/2; }
+  uintT getOutDegree() const { return ((this+1)->outNeighbors - outNeighbors)/2; }
+#endif
+
+  void setInDegree(uintT _d) {}
+  void setOutDegree(uintT _d) {}
+  void flipEdges() { swap(inNeighbors,outNeighbors); }
+
+  template <class VS, class F, class G>
+  inline void decodeInNghBreakEarly(long v_id, VS& vertexSubset, F &f, G &g, bool parallel = 0) {
+    decode_uncompressed::decodeInNghBreakEarly<csrAsymmetricVertex, F, G, VS>(this, v_id, vertexSubset, f, g, parallel);
+  }
+
+  template <class F, class G>
+  inline void decodeOutNgh(long i, F &f, G &g) {
+    decode_uncompressed::decodeOutNgh<csrAsymmetricVertex, F, G>(this, i, f, g);
+  }
+
+  template <class F, class G>
+  inline void decodeOutNghSparse(long i, uintT o, F &f, G &g) {
+    decode_uncompressed::decodeOutNghSparse<csrAsymmetricVertex, F>(this, i, o, f, g);
+  }
+
+  template <class F, class G>
+  inline void decodeOutNghSparseRange(long i, uintT o, uintT lo, uintT hi, F &f, G &g) {
+    decode_uncompressed::decodeOutNghSparseRange<csrAsymmetricVertex, F>(this, i, o, lo, hi, f, g);
+  }
+
+  template <class F, class G>
+  inline size_t decodeOutNghSparseSeq(long i, uintT o, F &f, G &g) {
+    return decode_uncompressed::decodeOutNghSparseSeq<csrAsymmetricVertex, F>(this, i, o, f, g);
+  }
+
+  template <class E, class F, class G>
+  inline void copyOutNgh(long i, uintT o, F& f, G& g) {
+    decode_uncompressed::copyOutNgh<csrAsymmetricVertex, E>(this, i, o, f, g);
+  }
+
+  template <class F>
+  inline size_t countOutNgh(long i, F &f) {
+    return decode_uncompressed::countOutNgh<csrAsymmetricVertex, F>(this, i, f);
+  }
+
+  template <class F>
+  inline size_t packOutNgh(long i, F &f, bool* bits, uintE* tmp1, uintE* tmp2) {
+    return decode_uncompressed::packOutNgh<csrAsymmetricVertex, F>(this, i, f, bits, tmp1);
+  }
+
+};
+
+template <class vertex> struct csrLayout { static const bool value = false; };
+template <> struct csrLayout<csrSymmetricVertex> { static const bool value = true; };
+template <> struct csrLayout<csrAsymmetricVertex> { static const bool value = true; };
+
+//vertex types of uncompressed graphs, whose edges can be indexed
+template <class vertex> struct uncompressedLayout {
+  static const bool value = is_same<vertex,symmetricVertex>::value ||
+    is_same<vertex,asymmetricVertex>::value || csrLayout<vertex>::value;
+};
+
+//vertex types of uncompressed graphs
+#ifdef CSR
+typedef csrSymmetricVertex uncompressedSymmetricVertex;
+typedef csrAsymmetricVertex uncompressedAsymmetricVertex;
+#else
+typedef symmetricVertex uncompressedSymmetricVertex;
+typedef asymmetricVertex uncompressedAsymmetricVertex;
+#endif
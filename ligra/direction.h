@@ -0,0 +1,118 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Policy choosing between the sparse (push) and dense (pull) edgeMap,
+// selected at runtime with -dir <mode>:
+//   fixed   dense when the frontier's vertices plus out-edges exceed m/20
+//           (the default, also used when no policy is set)
+//   beamer  the direction-optimizing model of Beamer et al.: switch to
+//           dense when the frontier's out-edges m_f exceed m_u/alpha,
+//           where m_u estimates the edges not yet explored by the
+//           traversal, and back to sparse once the frontier shrinks
+//           below n/beta vertices
+//   auto    beamer, with alpha calibrated from the measured cost per
+//           edge of the first sparse and dense edgeMaps on the graph
+// alpha and beta default to 15 and 18 and can be set with -alpha and
+// -beta; -dirlog prints every decision. m_u is restarted at m by
+// graph::resetDirection(), which traversals call when they start a new
+// search, and whenever the explored edges exceed it. An explicit
+// threshold passed to edgeMap takes precedence over the policy.
+#pragma once
+#include <iostream>
+#include <string.h>
+#include <algorithm>
+using namespace std;
+
+#define DIR_ALPHA 15.0
+#define DIR_BETA 18.0
+//work (edges) measured in each direction before alpha is calibrated
+#define DIR_CALIBRATE_MIN 100000
+
+struct directionPolicy {
+  bool beamer, calibrate, log;
+  double alpha, beta;
+  long n, m;
+  long unexplored;   //m_u, edges not explored by the current traversal
+  long lastFrontier; //vertices of the previous frontier
+  bool dense;        //previous decision
+  long work;         //edges the previous decision is expected to read
+  double sparseTime, denseTime;
+  long sparseWork, denseWork;
+  bool calibrated;
+
+  directionPolicy(long _n, long _m) : beamer(0), calibrate(0), log(0),
+    alpha(DIR_ALPHA), beta(DIR_BETA), n(_n), m(_m), work(0), sparseTime(0),
+    denseTime(0), sparseWork(0), denseWork(0), calibrated(0) {
+    reset();
+  }
+
+  //sets the mode from its name, returning false if it is unknown
+  bool setMode(const char* name) {
+    if (strcmp(name,"fixed") == 0) beamer = calibrate = 0;
+    else if (strcmp(name,"beamer") == 0) { beamer = 1; calibrate = 0; }
+    else if (strcmp(name,"auto") == 0) beamer = calibrate = 1;
+    else return false;
+    return true;
+  }
+
+  void reset() { unexplored = m; lastFrontier = 0; dense = 0; }
+
+  //returns whether to run dense on a frontier of nf vertices and mf
+  //out-edges, threshold being the fixed mode's threshold
+  bool choose(long nf, long mf, long threshold) {
+    bool d;
+    if (!beamer) d = nf + mf > threshold;
+    else {
+      if (mf > unexplored) unexplored = m; //a new traversal
+      if (!dense) d = mf > unexplored / alpha;
+      else d = nf >= lastFrontier || nf > n / beta; //stay while growing
+    }
+    if (log)
+      cout << "direction: " << (d ? "dense" : "sparse") << " frontier "
+           << nf << " vertices " << mf << " edges, unexplored "
+           << unexplored << endl;
+    work = d ? unexplored : mf;
+    unexplored = max(unexplored - mf, 0L);
+    lastFrontier = nf;
+    dense = d;
+    return d;
+  }
+
+  //whether the edgeMap just chosen should be timed for calibration
+  bool timing() { return calibrate && !calibrated; }
+
+  //records the time of the edgeMap just chosen; the dense cost per edge
+  //is relative to m_u, the edges the model expects it to read
+  void record(double seconds) {
+    if (dense) { denseTime += seconds; denseWork += work; }
+    else { sparseTime += seconds; sparseWork += work; }
+    if (sparseWork < DIR_CALIBRATE_MIN || denseWork < DIR_CALIBRATE_MIN ||
+        denseTime <= 0) return;
+    //dense is cheaper once mf * sparse cost > m_u * dense cost
+    double ratio = (sparseTime / sparseWork) / (denseTime / denseWork);
+    alpha = min(max(ratio, 1.0), 1000.0);
+    calibrated = 1;
+    if (log) cout << "direction: calibrated alpha = " << alpha << endl;
+  }
+};
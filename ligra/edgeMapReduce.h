@@ -13,8 +13,8 @@ inline vertexSubsetData<E> edgeMapInduced(graph<vertex>& GA, VS& V, F& f) {
   V.toSparse();
   auto degrees = array_imap<uintT>(m);
   granular_for(i, 0, m, (m > 2000), {
-    vertex v = G[V.vtx(i)];
-    uintE degree = v.getOutDegree();
+    vertex& v = G[V.vtx(i)];
+    uintT degree = v.getOutDegree();
     degrees[i] = degree;
   });
   long outEdgeCount = pbbs::scan_add(degrees, degrees);
@@ -24,7 +24,7 @@ inline vertexSubsetData<E> edgeMapInduced(graph<vertex>& GA, VS& V, F& f) {
   typedef tuple<uintE, E> VE;
   VE* outEdges = pbbs::new_array_no_init<VE>(outEdgeCount);
 
-  auto gen = [&] (const uintE& ngh, const uintE& offset, const Maybe<E>& val = Maybe<E>()) {
+  auto gen = [&] (const uintE& ngh, const uintT& offset, const Maybe<E>& val = Maybe<E>()) {
     outEdges[offset] = make_tuple(ngh, val.t);
   };
 
@@ -5,9 +5,17 @@
 #pragma once
 
 #include <type_traits>
+#include <vector>
 
 #include "binary_search.h"
 
+//destinations per bin of the propagation blocking push (log2)
+#define PB_BIN_BITS 16
+//tasks, each with its own bins, per worker in the push phase
+#define PB_TASKS_PER_WORKER 8
+//entries per chunk of the thread-local sparse output
+#define LOCAL_CHUNK 2048
+
 // Standard version of edgeMapDense.
 template <typename data, typename std::enable_if<
   std::is_same<data, pbbs::empty>::value, int>::type=0 >
@@ -38,6 +46,50 @@ auto get_emdense_forward_gen(tuple<bool, data>* next) {
     if (m.exists) next[ngh] = make_tuple(1, m.t); };
 }
 
+// Output of edgeMapDense and edgeMapDenseForward: an array of (flag,
+// data) pairs, or a bitmap when there is no data (see vertexSubset.h).
+// gen(true) may be used when all vertices of a 64-vertex block are
+// output by the same thread, so that bits are set without atomics.
+// clear(v) must be called on every vertex before its output is set,
+// unless the output is created cleared.
+template <class data>
+struct denseOutput {
+  using D = tuple<bool, data>;
+  D* next;
+  //the pairs are never cleared here: callers call clear(v) on every
+  //vertex, which clears the pair itself, so the flag does not apply
+  denseOutput(long n, bool = true) : next(newPoolA(D, n)) {}
+  inline void clear(long v) { std::get<0>(next[v]) = 0; }
+  inline bool isIn(long v) const { return std::get<0>(next[v]); }
+  auto gen(bool exclusive = false) { return get_emdense_gen<data>(next); }
+  auto forwardGen() { return get_emdense_forward_gen<data>(next); }
+  vertexSubsetData<data> result(long n) { return vertexSubsetData<data>(n, next); }
+};
+
+template <>
+struct denseOutput<pbbs::empty> {
+  uint64_t* next;
+  bool cleared;
+  //unless cleared here, clear() zeroes a word of the bitmap at the
+  //first vertex of its block, so the whole block must then be output
+  //by the thread that clears it
+  denseOutput(long n, bool _cleared = true) :
+    next(_cleared ? bitmap::empty(n) : newPoolA(uint64_t, bitmap::words(n))),
+    cleared(_cleared) {}
+  inline void clear(long v) { if (!cleared && !(v&63)) next[v>>6] = 0; }
+  inline bool isIn(long v) const { return bitmap::get(next, v); }
+  auto gen(bool exclusive = false) {
+    uint64_t* b = next;
+    return [b, exclusive] (uintE ngh, bool m=false) {
+      if (!m) return;
+      if (exclusive) b[ngh>>6] |= (uint64_t) 1 << (ngh&63);
+      else bitmap::setAtomic(b, ngh);
+    };
+  }
+  auto forwardGen() { return gen(); }
+  vertexSubset result(long n) { return vertexSubset::fromBitmap(n, next); }
+};
+
 // Standard version of edgeMapSparse.
 template <typename data, typename std::enable_if<
   std::is_same<data, pbbs::empty>::value, int>::type=0 >
@@ -93,6 +145,69 @@ auto get_emsparse_no_filter_gen(tuple<uintE, data>* outEdges) {
 
 
 
+// Thread-local output of edgeMapSparse (the local_output flag). Each
+// worker appends the (ngh, data) pairs that succeed to its own chunks of
+// LOCAL_CHUNK entries, which concat() copies into the output array after
+// a scan over the chunk sizes, so that the work and memory depend on the
+// output size and not on the number of edges scanned.
+template <class data>
+struct localOutput {
+  using S = tuple<uintE, data>;
+  struct worker {
+    std::vector<S*> chunks;
+    long fill;  //entries in the last chunk
+    char pad[64];
+    worker() : fill(LOCAL_CHUNK) {}
+  };
+  std::vector<worker> workers;
+  localOutput() : workers(getWorkers()) {}
+
+  inline void append(const S& e) {
+    worker& w = workers[getWorkerNum()];
+    if (w.fill == LOCAL_CHUNK) {
+      w.chunks.push_back(newA(S, LOCAL_CHUNK));
+      w.fill = 0;
+    }
+    w.chunks.back()[w.fill++] = e;
+  }
+
+  //returns the pairs in one array of size outSize and frees the chunks
+  S* concat(long& outSize) {
+    std::vector<tuple<S*, long>> all;
+    for (worker& w : workers)
+      for (size_t c=0; c<w.chunks.size(); c++)
+        all.push_back(make_tuple(w.chunks[c],
+          c+1 < w.chunks.size() ? (long) LOCAL_CHUNK : w.fill));
+    long k = all.size();
+    long* offsets = newA(long, k+1);
+    {parallel_for (long i=0; i<k; i++) offsets[i] = get<1>(all[i]);}
+    outSize = sequence::plusScan(offsets, offsets, k);
+    S* out = newPoolA(S, outSize);
+    {parallel_for (long i=0; i<k; i++) {
+      std::copy(get<0>(all[i]), get<0>(all[i]) + get<1>(all[i]), out + offsets[i]);
+      free(get<0>(all[i]));
+      }}
+    free(offsets);
+    return out;
+  }
+};
+
+template <typename data, typename std::enable_if<
+  std::is_same<data, pbbs::empty>::value, int>::type=0 >
+auto get_emsparse_local_gen(localOutput<data>* out) {
+  return [out] (uintE ngh, uintT offset, bool m=false) {
+    if (m) out->append(make_tuple(ngh, pbbs::empty()));
+  };
+}
+
+template <typename data, typename std::enable_if<
+  !std::is_same<data, pbbs::empty>::value, int>::type=0 >
+auto get_emsparse_local_gen(localOutput<data>* out) {
+  return [out] (uintE ngh, uintT offset, Maybe<data> m=Maybe<data>()) {
+    if (m.exists) out->append(make_tuple(ngh, m.t));
+  };
+}
+
 // Gen-functions that produce no output
 template <typename data, typename std::enable_if<
   std::is_same<data, pbbs::empty>::value, int>::type=0 >
@@ -129,3 +244,80 @@ template <typename data, typename std::enable_if<
 auto get_emdense_forward_nooutput_gen() {
   return [&] (uintE ngh, Maybe<data> m=Maybe<data>()) { };
 }
+
+// Propagation blocking (the propagation_blocking flag). Instead of
+// calling updateAtomic, the push phase computes f.value(s, d[, w]) for
+// each edge (s, d) with f.cond(d) and appends (d, value) to the bin of
+// d's range of 2^PB_BIN_BITS destinations; each task has its own bins.
+// The apply phase then hands each bin to one thread, which calls
+// f.reduce(d, value) without atomics. reduce returns whether d is added
+// to the output, like update.
+template <class F, class = void>
+struct has_reduce : std::false_type {};
+template <class F>
+struct has_reduce<F, decltype((void) &F::reduce)> : std::true_type {};
+
+#ifndef WEIGHTED
+template <class F>
+using blockedValue = decltype(std::declval<F&>().value(uintE(), uintE()));
+#else
+template <class F>
+using blockedValue = decltype(std::declval<F&>().value(uintE(), uintE(), weightT()));
+#endif
+
+// Functor passed to the decoders in the push phase. All bins are stored
+// in one array, ordered by bin and then by task, so that each bin is
+// contiguous. pos[b*tasks] is the position of the next entry of bin b of
+// this task (pos points at the task's column). With bins == NULL, the
+// entries are only counted in pos, to size the array.
+template <class F>
+struct blockedBins {
+  using E = tuple<uintE, blockedValue<F>>;
+  F& f;
+  E* bins;
+  uintT* pos;
+  long tasks;
+  blockedBins(F& _f, E* _bins, uintT* _pos, long _tasks)
+    : f(_f), bins(_bins), pos(_pos), tasks(_tasks) {}
+  static constexpr bool cond_always_true = condAlwaysTrue<F>::value;
+  inline bool cond(uintE d) { return checkCond(f, d); }
+  inline bool updateAtomic(uintE s, uintE d) {
+    uintT& p = pos[(d >> PB_BIN_BITS)*tasks];
+    if (bins != NULL) bins[p] = make_tuple(d, f.value(s, d));
+    p++;
+    return false;
+  }
+  template <class W>
+  inline bool updateAtomic(uintE s, uintE d, W w) {
+    uintT& p = pos[(d >> PB_BIN_BITS)*tasks];
+    if (bins != NULL) bins[p] = make_tuple(d, f.value(s, d, w));
+    p++;
+    return false;
+  }
+};
+
+// Epilogue and prologue of edgeMapThen. then(v) is called on each vertex
+// of the output, and then.pre(u), when T has such a member, on each vertex
+// of the input frontier before any of its edges are processed. noThen
+// has neither.
+struct noThen {};
+
+template <class T, class = void>
+struct has_then : std::false_type {};
+template <class T>
+struct has_then<T, decltype((void) std::declval<T&>()(uintE()))> : std::true_type {};
+
+template <class T, class = void>
+struct has_pre : std::false_type {};
+template <class T>
+struct has_pre<T, decltype((void) std::declval<T&>().pre(uintE()))> : std::true_type {};
+
+template <class T>
+inline void applyThen(T& t, uintE v, std::true_type) { t(v); }
+template <class T>
+inline void applyThen(T& t, uintE v, std::false_type) {}
+
+template <class T>
+inline void applyPre(T& t, uintE u, std::true_type) { t.pre(u); }
+template <class T>
+inline void applyPre(T& t, uintE u, std::false_type) {}
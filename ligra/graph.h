@@ -3,9 +3,18 @@
 #include <iostream>
 #include <fstream>
 #include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
 #include "vertex.h"
+#include "csrVertex.h"
 #include "compressedVertex.h"
 #include "parallel.h"
+#include "graphContainer.h"
+#include "semiExternal.h"
+#include "bigAlloc.h"
+#include "numaGraph.h"
+#include "direction.h"
+#include "segmentedGraph.h"
 using namespace std;
 
 // **************************************************************
@@ -33,9 +42,64 @@ public:
   void del() {
     if (allocatedInplace == NULL)
       for (long i=0; i < n; i++) V[i].del();
-    else free(allocatedInplace);
-    free(V);
-    if(inEdges != NULL) free(inEdges);
+    else bigFree(allocatedInplace);
+    bigFree(V);
+    if(inEdges != NULL) bigFree(inEdges);
+  }
+};
+
+// Graph whose edge array is a read-only memory mapping of the input file
+// (binary format loaded with -m). The mappings are released with munmap.
+// inEdges is either also a mapping (inEdgesSize > 0) or was built in
+// memory and is freed.
+template <class vertex>
+struct Mmapped_Mem : public Deletable {
+public:
+  vertex* V;
+  long n;
+  long m;
+  void* edges, *inEdges;
+  size_t edgesSize, inEdgesSize;
+
+  Mmapped_Mem(vertex* VV, long nn, long mm, void* _edges, size_t _edgesSize,
+              void* _inEdges = NULL, size_t _inEdgesSize = 0)
+  : V(VV), n(nn), m(mm), edges(_edges), edgesSize(_edgesSize),
+    inEdges(_inEdges), inEdgesSize(_inEdgesSize) { }
+
+  void del() {
+    if (munmap(edges, edgesSize) == -1) {
+      perror("munmap");
+      exit(-1);
+    }
+    bigFree(V);
+    if (inEdgesSize > 0) {
+      if (munmap(inEdges, inEdgesSize) == -1) {
+        perror("munmap");
+        exit(-1);
+      }
+    } else if (inEdges != NULL) bigFree(inEdges);
+  }
+};
+
+// Graph loaded from a graphContainer file. Sections used in place stay
+// in the container C (mapped or read into memory). edges and inEdges
+// are arrays built because a section had to be converted or
+// interleaved with its weights, and are NULL otherwise.
+template <class vertex>
+struct Container_Mem : public Deletable {
+public:
+  vertex* V;
+  containerFile C;
+  void* edges, *inEdges;
+
+  Container_Mem(vertex* VV, containerFile _C, void* _edges = NULL, void* _inEdges = NULL)
+  : V(VV), C(_C), edges(_edges), inEdges(_inEdges) { }
+
+  void del() {
+    bigFree(V);
+    C.del();
+    if (edges != NULL) bigFree(edges);
+    if (inEdges != NULL) bigFree(inEdges);
   }
 };
 
@@ -63,18 +127,26 @@ public:
   }
 };
 
+// s is either allocated or, if mappedSize > 0, a read-only mapping of
+// the compressed file (loaded with -m) that is released with munmap.
 template <class vertex>
 struct Compressed_Mem : public Deletable {
 public:
   vertex* V;
   char* s;
+  size_t mappedSize;
 
-  Compressed_Mem(vertex* _V, char* _s) :
-                 V(_V), s(_s) { }
+  Compressed_Mem(vertex* _V, char* _s, size_t _mappedSize = 0) :
+                 V(_V), s(_s), mappedSize(_mappedSize) { }
 
   void del() {
-    free(V);
-    free(s);
+    bigFree(V);
+    if (mappedSize > 0) {
+      if (munmap(s, mappedSize) == -1) {
+        perror("munmap");
+        exit(-1);
+      }
+    } else bigFree(s);
   }
 };
 
@@ -101,25 +173,152 @@ struct graph {
   long n;
   long m;
   bool transposed;
+  //set when the edges are used in place from a read-only mapping of
+  //the input file (-m), so they cannot be modified (e.g. by packEdges)
+  bool readOnly;
   uintE* flags;
   Deletable *D;
+  //mapped files holding the edges, used by the semi-external mode
+  semiExternal* SE;
+  //set for graphs relabeled by utils/reorderGraph: perm[v] is the ID
+  //of original vertex v
+  uintE* perm;
+  //vertex partitions of the NUMA-aware mode (-numa), NULL otherwise
+  numaPartitions* NP;
+  //direction policy of edgeMap (-dir), NULL for the fixed threshold
+  directionPolicy* DP;
+  //segmented in-edges of the cache-blocked dense edgeMap (-segment)
+  segmentedEdges* SG;
 
 graph(vertex* _V, long _n, long _m, Deletable* _D) : V(_V), n(_n), m(_m),
-  D(_D), flags(NULL), transposed(0) {}
+  D(_D), flags(NULL), transposed(0), readOnly(0), SE(NULL), perm(NULL),
+  NP(NULL), DP(NULL), SG(NULL) {}
 
 graph(vertex* _V, long _n, long _m, Deletable* _D, uintE* _flags) : V(_V),
-  n(_n), m(_m), D(_D), flags(_flags), transposed(0) {}
+  n(_n), m(_m), D(_D), flags(_flags), transposed(0), readOnly(0), SE(NULL),
+  perm(NULL), NP(NULL), DP(NULL), SG(NULL) {}
 
   void del() {
     if (flags != NULL) free(flags);
+    if (SE != NULL) { SE->del(); delete SE; }
+    if (perm != NULL) free(perm);
+    if (NP != NULL) { NP->del(); delete NP; }
+    if (DP != NULL) delete DP;
+    dropSegments();
     D->del();
     free(D);
   }
 
+  //records a read-only mapping of an input file holding edges
+  void addEdgeFile(const char* name, char* base, size_t size) {
+    if (SE == NULL) SE = new semiExternal();
+    SE->addFile(name, base, size);
+  }
+
+  //makes edgeMap read the edges from the mapped files (see semiExternal.h)
+  void enableSemiExternal() {
+    if (csrLayout<vertex>::value) {
+      cout << "semi-external mode does not support the CSR layout, "
+           << "running in memory" << endl;
+      return;
+    }
+    if (SE == NULL || !seUncompressed<vertex>::value) {
+      cout << "semi-external mode needs uncompressed edges memory-mapped "
+           << "with -m, running in memory" << endl;
+      return;
+    }
+    SE->enable();
+  }
+
+  //makes edgeMap pass madvise hints for the mapped files
+  void enableAdvice() {
+    if (SE == NULL) {
+      cout << "-advise needs edges memory-mapped with -m, ignoring it" << endl;
+      return;
+    }
+    SE->advise = 1;
+  }
+
+  //splits the vertices over the NUMA nodes (or into parts partitions),
+  //binds the vertex array and the uncompressed edges of each partition
+  //to its node and pins the workers (see numaGraph.h)
+  void enableNuma(int parts = 0) {
+    NP = new numaPartitions();
+    if (!NP->init(parts)) {
+      cout << "-numa: only one NUMA node found, ignoring it" << endl;
+      delete NP; NP = NULL;
+      return;
+    }
+    NP->split(V, n);
+    NP->place(V, sizeof(vertex));
+    if (seUncompressed<vertex>::value || csrLayout<vertex>::value) {
+      NP->placeEdges(V, true, SE_EDGE_BYTES);
+      if (sizeof(vertex) == sizeof(asymmetricVertex) ||
+          is_same<vertex,csrAsymmetricVertex>::value)
+        NP->placeEdges(V, false, SE_EDGE_BYTES);
+    }
+    if (NP->failed > 0)
+      cout << "-numa: " << NP->failed << " mbind calls failed" << endl;
+    NP->pinWorkers();
+  }
+
+  //builds the segmented in-edges used by dense edgeMaps, with segSize
+  //sources per segment (0 to size them from the last-level cache)
+  void enableSegments(long segSize = 0) {
+    if (!uncompressedLayout<vertex>::value) {
+      cout << "-segment needs an uncompressed graph, ignoring it" << endl;
+      return;
+    }
+    if (segSize <= 0) segSize = segmentedEdges::defaultSize();
+    dropSegments();
+    SG = new segmentedEdges();
+    SG->build(V, n, m, segSize, transposed,
+              integral_constant<bool,uncompressedLayout<vertex>::value>());
+  }
+
+  //the segments are a copy of the edges, dropped when they change
+  void dropSegments() { if (SG != NULL) { SG->del(); delete SG; SG = NULL; } }
+
+  //marks the start of a new traversal for the direction policy
+  void resetDirection() { if (DP != NULL) DP->reset(); }
+
+  //binds each partition of a per-vertex array to its node with -numa
+  template <class T>
+  void numaPlace(T* A) { if (NP != NULL) NP->place(A, sizeof(T)); }
+
+  //sets the vertex permutation; perm[v] is the new ID of original vertex v
+  void setPermutation(uintE* _perm) { perm = _perm; }
+
+  //ID of original vertex v in this graph; applications map the source
+  //vertex given with -r through it
+  long internalId(long v) {
+    if (perm == NULL) return v;
+    if (v < 0 || v >= n) {
+      cout << "vertex " << v << " out of range" << endl;
+      abort();
+    }
+    return perm[v];
+  }
+
+  //reorders a per-vertex array A (indexed by the graph's IDs) in place
+  //so that A[v] belongs to original vertex v, for applications that
+  //report per-vertex results
+  template <class T>
+  void toOriginalOrder(T* A) {
+    if (perm == NULL) return;
+    T* B = newA(T,n);
+    {parallel_for(long i=0;i<n;i++) B[i] = A[perm[i]];}
+    {parallel_for(long i=0;i<n;i++) A[i] = B[i];}
+    free(B);
+  }
+
   void transpose() {
     if ((sizeof(vertex) == sizeof(asymmetricVertex)) ||
-        (sizeof(vertex) == sizeof(compressedAsymmetricVertex))) {
-      parallel_for(long i=0;i<n;i++) {
+        (sizeof(vertex) == sizeof(compressedAsymmetricVertex)) ||
+        is_same<vertex,csrAsymmetricVertex>::value) {
+      //the CSR layout also flips the end marker V[n]
+      long k = csrLayout<vertex>::value ? n+1 : n;
+      parallel_for(long i=0;i<k;i++) {
         V[i].flipEdges();
       }
       transposed = !transposed;
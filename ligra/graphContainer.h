@@ -0,0 +1,325 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Single-file, self-describing binary graph container.
+//
+// The file starts with a containerHeader followed by a directory of
+// numSections containerSection entries. Each section holds one array of
+// fixed-width elements and starts on a page boundary, so every section
+// can be used in place from a memory mapping of the file. The header
+// records the element widths the file was written with, so a loader can
+// use a section in place when they match the build's intT/uintE and
+// convert it otherwise.
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "parallel.h"
+#include "utils.h"
+using namespace std;
+
+#define CONTAINER_MAGIC "LIGRAGPH"
+#define CONTAINER_VERSION 1
+#define CONTAINER_ALIGN 4096
+
+// Section identifiers. Offsets arrays have n+1 entries, edge and weight
+// arrays have m entries. The compressed sections store the Ligra+
+// encoding produced by encoder (per-vertex byte offsets, degrees and the
+// encoded edge bytes). The permutation (n entries) is written by
+// utils/reorderGraph and maps each original vertex ID to its new ID.
+enum containerSectionId {
+  SEC_OUT_OFFSETS = 1,
+  SEC_OUT_EDGES = 2,
+  SEC_OUT_WEIGHTS = 3,
+  SEC_IN_OFFSETS = 4,
+  SEC_IN_EDGES = 5,
+  SEC_IN_WEIGHTS = 6,
+  SEC_COMPRESSED_OUT_OFFSETS = 7,
+  SEC_COMPRESSED_OUT_DEGREES = 8,
+  SEC_COMPRESSED_OUT_EDGES = 9,
+  SEC_COMPRESSED_IN_OFFSETS = 10,
+  SEC_COMPRESSED_IN_DEGREES = 11,
+  SEC_COMPRESSED_IN_EDGES = 12,
+  SEC_PERMUTATION = 13
+};
+
+// Header flags.
+const uint32_t CONTAINER_SYMMETRIC = 1;
+const uint32_t CONTAINER_WEIGHTED = 2;
+// Compression scheme of the compressed sections.
+const uint32_t CONTAINER_BYTE = 4;
+const uint32_t CONTAINER_NIBBLE = 8;
+const uint32_t CONTAINER_BYTERLE = 16;
+const uint32_t CONTAINER_PD = 32; //encoded for parallel decoding
+const uint32_t CONTAINER_SCHEME_MASK = 4 | 8 | 16 | 32;
+
+//scheme selected at compile time, as in ligra.h and encoder.C
+#ifdef BYTE
+const uint32_t CONTAINER_SCHEME_BASE = CONTAINER_BYTE;
+#elif defined NIBBLE
+const uint32_t CONTAINER_SCHEME_BASE = CONTAINER_NIBBLE;
+#else
+const uint32_t CONTAINER_SCHEME_BASE = CONTAINER_BYTERLE;
+#endif
+#ifdef PD
+const uint32_t CONTAINER_SCHEME = CONTAINER_SCHEME_BASE | CONTAINER_PD;
+#else
+const uint32_t CONTAINER_SCHEME = CONTAINER_SCHEME_BASE;
+#endif
+
+struct containerHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t n;
+  uint64_t m;
+  uint32_t numSections;
+  uint32_t reserved;
+};
+
+struct containerSection {
+  uint32_t id;
+  uint32_t elemSize; // width of one element in bytes
+  uint64_t count;    // number of elements
+  uint64_t offset;   // byte offset of the section in the file
+};
+
+// Collects sections in memory and writes them out as one container file.
+struct containerWriter {
+  static const int maxSections = 16;
+  containerSection sections[maxSections];
+  const char* data[maxSections];
+  int numSections;
+
+  containerWriter() : numSections(0) {}
+
+  void add(uint32_t id, const void* A, uint32_t elemSize, uint64_t count) {
+    if (numSections == maxSections) {
+      cout << "containerWriter: too many sections" << endl;
+      abort();
+    }
+    sections[numSections].id = id;
+    sections[numSections].elemSize = elemSize;
+    sections[numSections].count = count;
+    data[numSections++] = (const char*) A;
+  }
+
+  void write(const char* fname, uint64_t n, uint64_t m, uint32_t flags) {
+    containerHeader h;
+    memcpy(h.magic, CONTAINER_MAGIC, 8);
+    h.version = CONTAINER_VERSION;
+    h.flags = flags;
+    h.n = n; h.m = m;
+    h.numSections = numSections;
+    h.reserved = 0;
+    uint64_t pos = sizeof(containerHeader) + numSections*sizeof(containerSection);
+    for (int i = 0; i < numSections; i++) {
+      pos = ((pos + CONTAINER_ALIGN - 1)/CONTAINER_ALIGN)*CONTAINER_ALIGN;
+      sections[i].offset = pos;
+      pos += sections[i].elemSize*sections[i].count;
+    }
+    ofstream out(fname, ofstream::out | ios::binary);
+    if (!out.is_open()) {
+      cout << "Unable to open file: " << fname << endl;
+      abort();
+    }
+    out.write((char*)&h, sizeof(containerHeader));
+    out.write((char*)sections, numSections*sizeof(containerSection));
+    char zeros[CONTAINER_ALIGN];
+    memset(zeros, 0, CONTAINER_ALIGN);
+    for (int i = 0; i < numSections; i++) {
+      uint64_t cur = out.tellp();
+      out.write(zeros, sections[i].offset - cur);
+      out.write(data[i], sections[i].elemSize*sections[i].count);
+    }
+    out.close();
+  }
+};
+
+// A container file that has been mapped (or read) into memory.
+struct containerFile {
+  char* base;
+  size_t size;
+  bool mapped;
+  containerHeader* header;
+  containerSection* sections;
+
+  containerFile() : base(NULL), size(0), mapped(0), header(NULL), sections(NULL) {}
+
+  containerSection* find(uint32_t id) const {
+    for (uint32_t i = 0; i < header->numSections; i++)
+      if (sections[i].id == id) return &sections[i];
+    return NULL;
+  }
+
+  bool has(uint32_t id) const { return find(id) != NULL; }
+
+  // Pointer to the start of a section, or NULL if the file does not have it.
+  void* get(uint32_t id) const {
+    containerSection* s = find(id);
+    return (s == NULL) ? NULL : (void*)(base + s->offset);
+  }
+
+  uint32_t elemSize(uint32_t id) const { return find(id)->elemSize; }
+  uint64_t count(uint32_t id) const { return find(id)->count; }
+  bool symmetric() const { return header->flags & CONTAINER_SYMMETRIC; }
+  bool weighted() const { return header->flags & CONTAINER_WEIGHTED; }
+
+  void del() {
+    if (mapped) {
+      if (munmap(base, size) == -1) {
+        perror("munmap");
+        exit(-1);
+      }
+    } else free(base);
+  }
+};
+
+// Returns true if fname starts with the container magic.
+inline bool isContainerFile(const char* fname) {
+  ifstream in(fname, ifstream::in | ios::binary);
+  if (!in.is_open()) return false;
+  char magic[8];
+  in.read(magic, 8);
+  return in.gcount() == 8 && memcmp(magic, CONTAINER_MAGIC, 8) == 0;
+}
+
+// Opens a container file. With mmap the file is mapped read-only and its
+// sections are used in place; otherwise it is read into memory.
+inline containerFile openContainer(const char* fname, bool mmap) {
+  containerFile C;
+  int fd = open(fname, O_RDONLY);
+  if (fd == -1) {
+    perror("open");
+    exit(-1);
+  }
+  struct stat sb;
+  if (fstat(fd, &sb) == -1) {
+    perror("fstat");
+    exit(-1);
+  }
+  C.size = sb.st_size;
+  C.mapped = mmap;
+  if (mmap) {
+    C.base = (char*) ::mmap(0, C.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (C.base == MAP_FAILED) {
+      perror("mmap");
+      exit(-1);
+    }
+  } else {
+    C.base = newA(char, C.size);
+    size_t r = 0;
+    while (r < C.size) {
+      ssize_t k = pread(fd, C.base + r, C.size - r, r);
+      if (k <= 0) {
+        perror("pread");
+        exit(-1);
+      }
+      r += k;
+    }
+  }
+  close(fd);
+  C.header = (containerHeader*) C.base;
+  C.sections = (containerSection*) (C.base + sizeof(containerHeader));
+  if (C.size < sizeof(containerHeader) ||
+      memcmp(C.header->magic, CONTAINER_MAGIC, 8) != 0) {
+    cout << "Bad container file: " << fname << endl;
+    abort();
+  }
+  if (C.header->version != CONTAINER_VERSION) {
+    cout << "Unsupported container version " << C.header->version << endl;
+    abort();
+  }
+  if (C.header->numSections > (C.size - sizeof(containerHeader)) / sizeof(containerSection)) {
+    cout << "Bad container file: section table out of bounds" << endl;
+    abort();
+  }
+  for (uint32_t i = 0; i < C.header->numSections; i++) {
+    containerSection& s = C.sections[i];
+    if (s.offset > C.size || s.count > (C.size - s.offset) / max(s.elemSize, 1u)) {
+      cout << "Bad container file: section " << s.id << " out of bounds" << endl;
+      abort();
+    }
+  }
+  return C;
+}
+
+// Returns the count integers of elemSize bytes at A as an array of T:
+// A itself if elemSize is sizeof(T), and otherwise a newly allocated
+// copy, which is also stored in owned for the caller to free (owned is
+// NULL otherwise). Used wherever the stored width of offsets or IDs
+// may differ from the uintT/uintE of the build (LONG, EDGELONG).
+template <class T>
+T* widthArray(char* A, long count, size_t elemSize, void*& owned) {
+  owned = NULL;
+  if (elemSize == sizeof(T)) return (T*) A;
+  T* B = newA(T, count);
+  if (elemSize == 8) {
+    parallel_for(long i=0;i<count;i++) B[i] = (T) ((uint64_t*)A)[i];
+  } else if (elemSize == 4) {
+    parallel_for(long i=0;i<count;i++) B[i] = (T) ((uint32_t*)A)[i];
+  } else if (elemSize == 2) {
+    parallel_for(long i=0;i<count;i++) B[i] = (T) ((uint16_t*)A)[i];
+  } else if (elemSize == 1) {
+    parallel_for(long i=0;i<count;i++) B[i] = (T) ((uint8_t*)A)[i];
+  } else {
+    cout << "Bad element size " << elemSize << endl;
+    abort();
+  }
+  owned = B;
+  return B;
+}
+
+// Returns section id as an array of T. The section is used in place if
+// its elements are already sizeof(T) bytes wide; otherwise it is
+// converted into a newly allocated array, which is added to owned (at
+// most one conversion per call) so the caller can free it.
+template <class T>
+T* containerArray(const containerFile& C, uint32_t id, void*& owned) {
+  containerSection* s = C.find(id);
+  owned = NULL;
+  if (s == NULL) return NULL;
+  return widthArray<T>(C.base + s->offset, s->count, s->elemSize, owned);
+}
+
+// Returns section id as a newly allocated array of T that the caller
+// frees, or NULL if the file does not have it.
+template <class T>
+T* containerCopy(const containerFile& C, uint32_t id) {
+  void* owned;
+  T* A = containerArray<T>(C, id, owned);
+  if (A == NULL || owned != NULL) return A;
+  long count = C.count(id);
+  T* B = newA(T, count);
+  parallel_for(long i=0;i<count;i++) B[i] = A[i];
+  return B;
+}
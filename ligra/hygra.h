@@ -55,7 +55,7 @@ template <class data, class vertex, class VS, class F>
 	if ((start == end-1) || (G[end].getInNeighbors()-G[start].getInNeighbors() < GRAIN_SIZE*sizeof(intE))){ 
 	  for (intT v = start; v < end; v++){
 	    std::get<0>(next[v]) = 0;
-	    if (f.cond(v)) {
+	    if (checkCond(f, v)) {
 	      G[v].decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel);
 	    }
 	  }
@@ -73,7 +73,7 @@ template <class data, class vertex, class VS, class F>
 	(intT start, intT end){
 	if ((start == end-1) || (G[end].getInNeighbors()-G[start].getInNeighbors() < GRAIN_SIZE*sizeof(intE))){
 	  for (intT v = start; v < end; v++){
-	    if (f.cond(v)) {
+	    if (checkCond(f, v)) {
 	      G[v].decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel);
 	    }
 	  } 
@@ -92,7 +92,7 @@ template <class data, class vertex, class VS, class F>
       auto g = get_emdense_gen<data>(next);
       parallel_for (long v=0; v<nTo; v++) {
         std::get<0>(next[v]) = 0;
-        if (f.cond(v)) {
+        if (checkCond(f, v)) {
           G[v].decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel);
         }
       }
@@ -100,7 +100,7 @@ template <class data, class vertex, class VS, class F>
     } else {
       auto g = get_emdense_nooutput_gen<data>();
       parallel_for (long v=0; v<nTo; v++) {
-        if (f.cond(v)) {
+        if (checkCond(f, v)) {
           G[v].decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel);
         }
       }
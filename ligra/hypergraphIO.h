@@ -26,6 +26,10 @@
 #include "IO.h"
 using namespace std;
 
+#if defined(WEIGHTED) && defined(SOA)
+#error "hypergraphs keep the weights interleaved, do not combine them with SOA"
+#endif
+
 template <class vertex>
 hypergraph<vertex> readHypergraphFromFile(char* fname, bool isSymmetric, bool mmap) {
   words W;
@@ -0,0 +1,144 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Resource records for runs under memory pressure. With -stats <file>
+// ("-" for stdout), the loaders, each round of the application,
+// edgeMapData and vertexMap append one JSON object per call to <file>,
+// holding the wall time and the changes during the call of
+//   minflt, majflt  minor and major page faults (getrusage)
+//   read_bytes      bytes read from storage (/proc/self/io)
+//   pswpin          pages swapped in, system-wide (/proc/vmstat)
+// and the resident set size at the end of the call (rss, in bytes).
+// Records carry the round (one per call of Compute) and, for edgeMap,
+// the number of the call within the round (e.g. the BFS level).
+#pragma once
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+struct ioSample {
+  double time;
+  long minflt, majflt, readBytes, pswpin, rss;
+};
+
+// Returns the number following key in a /proc file of "key value" or
+// "key: value" lines, or 0 if the file or key does not exist.
+inline long readProcField(const char* fname, const char* key) {
+  FILE* f = fopen(fname, "r");
+  if (f == NULL) return 0;
+  char line[256];
+  long val = 0;
+  size_t len = strlen(key);
+  while (fgets(line, sizeof(line), f) != NULL) {
+    if (strncmp(line, key, len) == 0 && (line[len] == ' ' || line[len] == ':')) {
+      val = atol(line + len + 1);
+      break;
+    }
+  }
+  fclose(f);
+  return val;
+}
+
+inline ioSample ioSampleNow() {
+  ioSample s;
+  timeval now;
+  gettimeofday(&now, NULL);
+  s.time = now.tv_sec + now.tv_usec/1000000.;
+  struct rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  s.minflt = ru.ru_minflt;
+  s.majflt = ru.ru_majflt;
+  s.readBytes = readProcField("/proc/self/io", "read_bytes");
+  s.pswpin = readProcField("/proc/vmstat", "pswpin");
+  long pages = 0, resident = 0;
+  FILE* f = fopen("/proc/self/statm", "r");
+  if (f != NULL) {
+    if (fscanf(f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+    fclose(f);
+  }
+  s.rss = resident*sysconf(_SC_PAGESIZE);
+  return s;
+}
+
+struct ioStats {
+  FILE* out;
+  long round, iter;
+
+  ioStats() : out(NULL), round(0), iter(0) {}
+
+  bool on() const { return out != NULL; }
+
+  void open(const char* fname) {
+    out = (strcmp(fname, "-") == 0) ? stdout : fopen(fname, "w");
+    if (out == NULL) {
+      perror("fopen");
+      exit(-1);
+    }
+  }
+
+  void close() {
+    if (out != NULL && out != stdout) fclose(out);
+    out = NULL;
+  }
+
+  void nextRound() { round++; iter = 0; }
+
+  void record(const char* event, const ioSample& s0, const char* mode,
+              long frontier, long edges) {
+    ioSample s1 = ioSampleNow();
+    fprintf(out, "{\"event\":\"%s\",\"round\":%ld", event, round);
+    if (strcmp(event, "edgeMap") == 0) fprintf(out, ",\"iter\":%ld", iter++);
+    if (mode != NULL) fprintf(out, ",\"mode\":\"%s\"", mode);
+    if (frontier >= 0) fprintf(out, ",\"frontier\":%ld", frontier);
+    if (edges >= 0) fprintf(out, ",\"edges\":%ld", edges);
+    fprintf(out, ",\"time\":%.6f,\"minflt\":%ld,\"majflt\":%ld,\"read_bytes\":%ld,"
+            "\"pswpin\":%ld,\"rss\":%ld}\n", s1.time - s0.time,
+            s1.minflt - s0.minflt, s1.majflt - s0.majflt,
+            s1.readBytes - s0.readBytes, s1.pswpin - s0.pswpin, s1.rss);
+    fflush(out);
+  }
+};
+
+static ioStats _ioStats;
+
+// Records the enclosing scope as one event when -stats is given. mode,
+// frontier and edges are optional fields that the scope can fill in
+// before it ends.
+struct ioScope {
+  const char* event;
+  const char* mode;
+  long frontier, edges;
+  ioSample s0;
+
+  ioScope(const char* _event) : event(_event), mode(NULL), frontier(-1), edges(-1) {
+    if (_ioStats.on()) s0 = ioSampleNow();
+  }
+
+  ~ioScope() {
+    if (_ioStats.on()) _ioStats.record(event, s0, mode, frontier, edges);
+  }
+};
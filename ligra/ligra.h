@@ -31,6 +31,7 @@
 #include <algorithm>
 #include "parallel.h"
 #include "gettime.h"
+#include "ioStats.h"
 #include "utils.h"
 #include "vertex.h"
 #include "compressedVertex.h"
@@ -40,6 +41,7 @@
 #include "parseCommandLine.h"
 #include "index_map.h"
 #include "edgeMap_utils.h"
+#include "workQueues.h"
 using namespace std;
 
 //*****START FRAMEWORK*****
@@ -53,27 +55,85 @@ const flags dense_parallel = 16;
 const flags remove_duplicates = 32;
 const flags no_dense = 64;
 const flags edge_parallel = 128;
+const flags propagation_blocking = 256;
+const flags local_output = 512;
+const flags asynchronous = 1024;
 inline bool should_output(const flags& fl) { return !(fl & no_output); }
 
-template <class data, class vertex, class VS, class F>
-vertexSubsetData<data> edgeMapDense(graph<vertex> GA, VS& vertexSubset, F &f, const flags fl) {
-  using D = tuple<bool, data>;
+//edges per task of the edge-balanced sparse edgeMap (edge_parallel)
+#define SPARSE_BLOCK 10000
+
+// The epilogue of edgeMapThen (then) is applied to each output vertex as
+// soon as its in-edges are processed, except with segments, where they
+// are processed in several passes.
+template <class data, class vertex, class VS, class F, class T>
+vertexSubsetData<data> edgeMapDense(graph<vertex> GA, VS& vertexSubset, F &f, T& then, const flags fl) {
   long n = GA.n;
   vertex *G = GA.V;
+  bool semiExt = GA.SE != NULL && GA.SE->enabled;
+  //the segments are built for one orientation of the edges
+  bool segmented = GA.SG != NULL && GA.SG->transposed == GA.transposed && !semiExt;
+  auto cond = [&] (long v) { return checkCond(f, v); };
   if (should_output(fl)) {
-    D* next = newA(D, n);
-    auto g = get_emdense_gen<data>(next);
-    parallel_for (long v=0; v<n; v++) {
-      std::get<0>(next[v]) = 0;
-      if (f.cond(v)) {
-        G[v].decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel);
+    //the default loop below clears each block of the output itself
+    denseOutput<data> next(n, semiExt || segmented || GA.NP != NULL);
+    auto g = next.gen();
+    auto done = [&] (long v) {
+      if (has_then<T>::value && next.isIn(v)) applyThen(then, v, has_then<T>()); };
+    if (semiExt) {
+      parallel_for (long v=0; v<n; v++) next.clear(v);
+      GA.SE->forBlocks(G, n, true, cond, [&] (long v, vertex& V) {
+          V.decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel);
+          done(v); });
+      return next.result(n);
+    }
+    if (segmented) {
+      parallel_for (long v=0; v<n; v++) next.clear(v);
+      GA.SG->pull(vertexSubset, f, g);
+      if (has_then<T>::value) {parallel_for (long v=0; v<n; v++) done(v);}
+      return next.result(n);
+    }
+    if (GA.NP != NULL) {
+      GA.NP->forVertices([&] (long v) {
+          next.clear(v);
+          if (checkCond(f, v)) {
+            G[v].decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel);
+            done(v);
+          } });
+      return next.result(n);
+    }
+    //blocks of 64 vertices, so that each word of a bitmap output is
+    //written by one thread
+    auto gb = next.gen(!(fl & dense_parallel));
+    parallel_for (long w=0; w<(n+63)/64; w++) {
+      for (long v=64*w; v<min(n,64*w+64); v++) {
+        next.clear(v);
+        if (checkCond(f, v)) {
+          G[v].decodeInNghBreakEarly(v, vertexSubset, f, gb, fl & dense_parallel);
+          done(v);
+        }
       }
     }
-    return vertexSubsetData<data>(n, next);
+    return next.result(n);
   } else {
     auto g = get_emdense_nooutput_gen<data>();
+    if (semiExt) {
+      GA.SE->forBlocks(G, n, true, cond, [&] (long v, vertex& V) {
+          V.decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel); });
+      return vertexSubsetData<data>(n);
+    }
+    if (segmented) {
+      GA.SG->pull(vertexSubset, f, g);
+      return vertexSubsetData<data>(n);
+    }
+    if (GA.NP != NULL) {
+      GA.NP->forVertices([&] (long v) {
+          if (checkCond(f, v))
+            G[v].decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel); });
+      return vertexSubsetData<data>(n);
+    }
     parallel_for (long v=0; v<n; v++) {
-      if (f.cond(v)) {
+      if (checkCond(f, v)) {
         G[v].decodeInNghBreakEarly(v, vertexSubset, f, g, fl & dense_parallel);
       }
     }
@@ -83,21 +143,42 @@ vertexSubsetData<data> edgeMapDense(graph<vertex> GA, VS& vertexSubset, F &f, co
 
 template <class data, class vertex, class VS, class F>
 vertexSubsetData<data> edgeMapDenseForward(graph<vertex> GA, VS& vertexSubset, F &f, const flags fl) {
-  using D = tuple<bool, data>;
   long n = GA.n;
   vertex *G = GA.V;
+  bool semiExt = GA.SE != NULL && GA.SE->enabled;
+  auto isIn = [&] (long i) { return vertexSubset.isIn(i); };
   if (should_output(fl)) {
-    D* next = newA(D, n);
-    auto g = get_emdense_forward_gen<data>(next);
-    parallel_for(long i=0;i<n;i++) { std::get<0>(next[i]) = 0; }
+    denseOutput<data> next(n);
+    auto g = next.forwardGen();
+    parallel_for(long i=0;i<n;i++) { next.clear(i); }
+    if (semiExt) {
+      GA.SE->forBlocks(G, n, false, isIn, [&] (long i, vertex& V) {
+          V.decodeOutNgh(i, f, g); });
+      return next.result(n);
+    }
+    if (GA.NP != NULL) {
+      GA.NP->forVertices([&] (long i) {
+          if (vertexSubset.isIn(i)) G[i].decodeOutNgh(i, f, g); });
+      return next.result(n);
+    }
     parallel_for (long i=0; i<n; i++) {
       if (vertexSubset.isIn(i)) {
         G[i].decodeOutNgh(i, f, g);
       }
     }
-    return vertexSubsetData<data>(n, next);
+    return next.result(n);
   } else {
     auto g = get_emdense_forward_nooutput_gen<data>();
+    if (semiExt) {
+      GA.SE->forBlocks(G, n, false, isIn, [&] (long i, vertex& V) {
+          V.decodeOutNgh(i, f, g); });
+      return vertexSubsetData<data>(n);
+    }
+    if (GA.NP != NULL) {
+      GA.NP->forVertices([&] (long i) {
+          if (vertexSubset.isIn(i)) G[i].decodeOutNgh(i, f, g); });
+      return vertexSubsetData<data>(n);
+    }
     parallel_for (long i=0; i<n; i++) {
       if (vertexSubset.isIn(i)) {
         G[i].decodeOutNgh(i, f, g);
@@ -107,35 +188,102 @@ vertexSubsetData<data> edgeMapDenseForward(graph<vertex> GA, VS& vertexSubset, F
   }
 }
 
+// Edge-balanced loop of edgeMapSparse (edge_parallel): the frontier's
+// out-edges, numbered by offsets (the scan of its degrees), are split
+// into blocks of SPARSE_BLOCK edges, each found by binary search and
+// processed by one task, so that a hub is spread over all workers.
+// Compressed lists cannot be entered in the middle, so a block that
+// starts inside one decodes the list from its start and skips the edges
+// before the block; the skipped edges are only decoded, not updated.
+template <class vertex, class VS, class F, class Gen>
+void edgeBlocksSparse(vertex* G, vertex* staged, VS& indices, uintT* offsets,
+    uintT m, size_t outEdgeCount, F& f, Gen& g) {
+  size_t n_blocks = nblocks(outEdgeCount, SPARSE_BLOCK);
+  auto offsets_m = make_in_imap<uintT>(m, [&] (size_t i) { return offsets[i]; });
+  auto le = [] (const uintT& l, const uintT& r) { return l <= r; };
+  parallel_for (size_t b=0; b<n_blocks; b++) {
+    size_t s = b*SPARSE_BLOCK, e = min(s+SPARSE_BLOCK, outEdgeCount);
+    //the vertex holding edge s
+    size_t i = pbbs::binary_search(offsets_m, s, le) - 1;
+    for (; i<m && offsets[i]<e; i++) {
+      uintE v = indices.vtx(i);
+      vertex& vert = staged != NULL ? staged[i] : G[v];
+      size_t o = offsets[i];
+      size_t d = (i+1 < m ? offsets[i+1] : outEdgeCount) - o;
+      vert.decodeOutNghSparseRange(v, o, s > o ? s-o : 0, min(d, e-o), f, g);
+    }
+  }
+}
+
+// The frontier's vertices are read in place from GA.V, or from the
+// copies in staged (semi-external mode) if it is not NULL. The output
+// has a slot per out-edge of the frontier that is filtered afterwards,
+// or with local_output is appended to per-worker buffers (localOutput in
+// edgeMap_utils.h) that only hold the neighbors that succeed.
 template <class data, class vertex, class VS, class F>
-vertexSubsetData<data> edgeMapSparse(graph<vertex>& GA, vertex* frontierVertices, VS& indices,
+vertexSubsetData<data> edgeMapSparse(graph<vertex>& GA, vertex* staged, VS& indices,
         uintT* degrees, uintT m, F &f, const flags fl) {
   using S = tuple<uintE, data>;
   long n = indices.n;
+  vertex* G = GA.V;
   S* outEdges;
   long outEdgeCount = 0;
-
-  if (should_output(fl)) {
+  //decodes the frontier's edges without numbering them for an output
+  //array (they are only numbered to split them for edge_parallel)
+  auto unnumbered = [&] (auto& g) {
+    if ((fl & edge_parallel) && degrees != NULL) {
+      long edges = sequence::plusScan(degrees, degrees, m);
+      edgeBlocksSparse(G, staged, indices, degrees, m, edges, f, g);
+    } else {
+      parallel_for (size_t i = 0; i < m; i++) {
+        uintT v = indices.vtx(i);
+        vertex& vert = staged != NULL ? staged[i] : G[v];
+        vert.decodeOutNghSparse(v, 0, f, g);
+      }
+    }
+  };
+
+  if (should_output(fl) && (fl & local_output)) {
+    localOutput<data> local;
+    auto g = get_emsparse_local_gen<data>(&local);
+    unnumbered(g);
+    long outSize;
+    S* out = local.concat(outSize);
+    if (fl & remove_duplicates) {
+      if (GA.flags == NULL) {
+        GA.flags = newA(uintE, n);
+        parallel_for(long i=0;i<n;i++) { GA.flags[i]=UINT_E_MAX; }
+      }
+      auto get_key = [&] (size_t i) -> uintE& { return std::get<0>(out[i]); };
+      remDuplicates(get_key, GA.flags, outSize, n);
+      S* nextIndices = newPoolA(S, outSize);
+      auto p = [] (tuple<uintE, data>& v) { return std::get<0>(v) != UINT_E_MAX; };
+      size_t nextM = pbbs::filterf(out, nextIndices, outSize, p);
+      bigFree(out);
+      return vertexSubsetData<data>(n, nextM, nextIndices);
+    }
+    return vertexSubsetData<data>(n, outSize, out);
+  } else if (should_output(fl)) {
     uintT* offsets = degrees;
     outEdgeCount = sequence::plusScan(offsets, offsets, m);
-    outEdges = newA(S, outEdgeCount);
+    outEdges = newPoolA(S, outEdgeCount);
     auto g = get_emsparse_gen<data>(outEdges);
-    parallel_for (size_t i = 0; i < m; i++) {
-      uintT v = indices.vtx(i), o = offsets[i];
-      vertex vert = frontierVertices[i];
-      vert.decodeOutNghSparse(v, o, f, g);
+    if (fl & edge_parallel) {
+      edgeBlocksSparse(G, staged, indices, offsets, m, outEdgeCount, f, g);
+    } else {
+      parallel_for (size_t i = 0; i < m; i++) {
+        uintT v = indices.vtx(i), o = offsets[i];
+        vertex& vert = staged != NULL ? staged[i] : G[v];
+        vert.decodeOutNghSparse(v, o, f, g);
+      }
     }
   } else {
     auto g = get_emsparse_nooutput_gen<data>();
-    parallel_for (size_t i = 0; i < m; i++) {
-      uintT v = indices.vtx(i);
-      vertex vert = frontierVertices[i];
-      vert.decodeOutNghSparse(v, 0, f, g);
-    }
+    unnumbered(g);
   }
 
   if (should_output(fl)) {
-    S* nextIndices = newA(S, outEdgeCount);
+    S* nextIndices = newPoolA(S, outEdgeCount);
     if (fl & remove_duplicates) {
       if (GA.flags == NULL) {
         GA.flags = newA(uintE, n);
@@ -146,7 +294,7 @@ vertexSubsetData<data> edgeMapSparse(graph<vertex>& GA, vertex* frontierVertices
     }
     auto p = [] (tuple<uintE, data>& v) { return std::get<0>(v) != UINT_E_MAX; };
     size_t nextM = pbbs::filterf(outEdges, nextIndices, outEdgeCount, p);
-    free(outEdges);
+    bigFree(outEdges);
     return vertexSubsetData<data>(n, nextM, nextIndices);
   } else {
     return vertexSubsetData<data>(n);
@@ -155,12 +303,13 @@ vertexSubsetData<data> edgeMapSparse(graph<vertex>& GA, vertex* frontierVertices
 
 template <class data, class vertex, class VS, class F>
 vertexSubsetData<data> edgeMapSparse_no_filter(graph<vertex>& GA,
-    vertex* frontierVertices, VS& indices, uintT* offsets, uintT m, F& f,
+    vertex* staged, VS& indices, uintT* offsets, uintT m, F& f,
     const flags fl) {
   using S = tuple<uintE, data>;
   long n = indices.n;
+  vertex* G = GA.V;
   long outEdgeCount = sequence::plusScan(offsets, offsets, m);
-  S* outEdges = newA(S, outEdgeCount);
+  S* outEdges = newPoolA(S, outEdgeCount);
 
   auto g = get_emsparse_no_filter_gen<data>(outEdges);
 
@@ -168,7 +317,7 @@ vertexSubsetData<data> edgeMapSparse_no_filter(graph<vertex>& GA,
   size_t b_size = 10000;
   size_t n_blocks = nblocks(outEdgeCount, b_size);
 
-  uintE* cts = newA(uintE, n_blocks+1);
+  uintT* cts = newA(uintT, n_blocks+1); //summed into the output size
   size_t* block_offs = newA(size_t, n_blocks+1);
 
   auto offsets_m = make_in_imap<uintT>(m, [&] (size_t i) { return offsets[i]; });
@@ -187,7 +336,8 @@ vertexSubsetData<data> edgeMapSparse_no_filter(graph<vertex>& GA,
       uintT k = start_o;
       for (size_t j=start; j<end; j++) {
         uintE v = indices.vtx(j);
-        size_t num_in = frontierVertices[j].decodeOutNghSparseSeq(v, k, f, g);
+        vertex& vert = staged != NULL ? staged[j] : G[v];
+        size_t num_in = vert.decodeOutNghSparseSeq(v, k, f, g);
         k += num_in;
       }
       cts[i] = (k - start_o);
@@ -199,7 +349,7 @@ vertexSubsetData<data> edgeMapSparse_no_filter(graph<vertex>& GA,
   long outSize = sequence::plusScan(cts, cts, n_blocks);
   cts[n_blocks] = outSize;
 
-  S* out = newA(S, outSize);
+  S* out = newPoolA(S, outSize);
 
   parallel_for (size_t i=0; i<n_blocks; i++) {
     if ((i == n_blocks-1) || block_offs[i] != block_offs[i+1]) {
@@ -212,7 +362,7 @@ vertexSubsetData<data> edgeMapSparse_no_filter(graph<vertex>& GA,
       }
     }
   }
-  free(outEdges); free(cts); free(block_offs);
+  bigFree(outEdges); free(cts); free(block_offs);
 
   if (fl & remove_duplicates) {
     if (GA.flags == NULL) {
@@ -221,56 +371,231 @@ vertexSubsetData<data> edgeMapSparse_no_filter(graph<vertex>& GA,
     }
     auto get_key = [&] (size_t i) -> uintE& { return std::get<0>(out[i]); };
     remDuplicates(get_key, GA.flags, outSize, n);
-    S* nextIndices = newA(S, outSize);
+    S* nextIndices = newPoolA(S, outSize);
     auto p = [] (tuple<uintE, data>& v) { return std::get<0>(v) != UINT_E_MAX; };
     size_t nextM = pbbs::filterf(out, nextIndices, outSize, p);
-    free(out);
+    bigFree(out);
     return vertexSubsetData<data>(n, nextM, nextIndices);
   }
   return vertexSubsetData<data>(n, outSize, out);
 }
 
-// Decides on sparse or dense base on number of nonzeros in the active vertices.
-template <class data, class vertex, class VS, class F>
+// Propagation blocking push for sparse and dense_forward edgeMaps (see
+// edgeMap_utils.h), used with the propagation_blocking flag. The frontier
+// is split into tasks that bin the values of their edges by destination
+// range, and each range is then reduced by one thread. The tasks first
+// count the entries of each of their bins, whose scan places the bins in
+// one pooled array, and then decode their edges again to fill it. The
+// output is sparse.
+template <class data, class vertex, class VS, class F, typename std::enable_if<
+  std::is_same<data, pbbs::empty>::value && has_reduce<F>::value, int>::type=0 >
+vertexSubsetData<data> edgeMapBlocked(graph<vertex>& GA, VS& vs, F& f, const flags fl) {
+  using E = typename blockedBins<F>::E;
+  vs.toSparse();
+  long n = GA.n, m = vs.numNonzeros();
+  vertex* G = GA.V;
+  long tasks = min(m, (long) PB_TASKS_PER_WORKER * getWorkers());
+  long B = (n >> PB_BIN_BITS) + 1;
+  //pos[b*tasks + t] is the count, and then the position, of bin b of task t
+  uintT* pos = newPoolA(uintT, B*tasks);
+  {parallel_for (long i=0; i<B*tasks; i++) pos[i] = 0;}
+  auto g = [] (uintE ngh, uintT offset, bool m) { return false; };
+  auto push = [&] (E* bins) {
+    parallel_for (long t=0; t<tasks; t++) {
+      blockedBins<F> bf(f, bins, pos + t, tasks);
+      for (long i=m*t/tasks; i<m*(t+1)/tasks; i++) {
+        uintE v = vs.vtx(i);
+        G[v].decodeOutNghSparseSeq(v, 0, bf, g);
+      }
+    }
+  };
+  push(NULL);
+  long total = sequence::plusScan(pos, pos, B*tasks);
+  E* bins = newPoolA(E, total);
+  push(bins);
+  //each position now is the end of its bin, so bin b spans the end of
+  //the last bin of b-1 to the end of its last bin
+  bool output = should_output(fl);
+  uintE* out = output ? newPoolA(uintE, total) : NULL;
+  parallel_for (long b=0; b<B; b++) {
+    long s = b == 0 ? 0 : pos[b*tasks-1], e = pos[(b+1)*tasks-1];
+    for (long j=s; j<e; j++) {
+      uintE d = get<0>(bins[j]);
+      bool added = f.reduce(d, get<1>(bins[j]));
+      if (output) out[j] = added ? d : UINT_E_MAX;
+    }
+  }
+  bigFree(bins); bigFree(pos);
+  if (!output) return vertexSubsetData<data>(n);
+  uintE* indices = newPoolA(uintE, total);
+  auto p = [] (uintE v) { return v != UINT_E_MAX; };
+  size_t outSize = pbbs::filterf(out, indices, total, p);
+  bigFree(out);
+  if (outSize == 0) { bigFree(indices); return vertexSubsetData<data>(n); }
+  return vertexSubsetData<data>(n, outSize, indices);
+}
+
+template <class data, class vertex, class VS, class F, typename std::enable_if<
+  !std::is_same<data, pbbs::empty>::value || !has_reduce<F>::value, int>::type=0 >
+vertexSubsetData<data> edgeMapBlocked(graph<vertex>& GA, VS& vs, F& f, const flags fl) {
+  cout << "edgeMap: propagation_blocking needs a functor with value() and "
+       << "reduce(), and no output data" << endl;
+  abort();
+}
+
+// Asynchronous edgeMap (the asynchronous flag) for functors whose updates
+// are monotone, such as writeMin: instead of being output for the next
+// round, a vertex activated by updateAtomic is queued (see workQueues.h)
+// and processed by the first worker that takes it, with the destination
+// values current at that time, until no vertex is active. updateAtomic
+// must return true every time it changes the destination. The edgeMap
+// runs to convergence and returns an empty vertexSubset.
+template <class data, class vertex, class VS, class F, typename std::enable_if<
+  std::is_same<data, pbbs::empty>::value, int>::type=0 >
+vertexSubsetData<data> edgeMapAsync(graph<vertex>& GA, VS& vs, F& f) {
+  vertex* G = GA.V;
+  int P = getWorkers();
+  vs.toSparse();
+  workQueues Q(P);
+  Q.init(vs.numNonzeros(), [&] (long i) { return vs.vtx(i); });
+  parallel_for_1 (int w=0; w<P; w++) {
+    vector<uintE> batch, out;
+    auto g = [&] (uintE ngh, uintT o, bool m) {
+      if (m) out.push_back(ngh);
+      return false; };
+    while (Q.take(w, batch)) {
+      for (uintE u : batch) G[u].decodeOutNghSparseSeq(u, 0, f, g);
+      Q.finish(w, batch.size(), out);
+    }
+  }
+  return vertexSubsetData<data>(GA.n);
+}
+
+template <class data, class vertex, class VS, class F, typename std::enable_if<
+  !std::is_same<data, pbbs::empty>::value, int>::type=0 >
+vertexSubsetData<data> edgeMapAsync(graph<vertex>& GA, VS& vs, F& f) {
+  cout << "edgeMap: asynchronous does not support output data" << endl;
+  abort();
+}
+
+// Calls g(v) on each vertex v of vs.
+template <class VS, class G>
+void forEachIn(VS& vs, G g) {
+  long n = vs.numRows(), m = vs.numNonzeros();
+  if (vs.dense()) {
+    denseView(vs, [&] (auto& view) {
+        parallel_for (long i=0; i<n; i++) if (view.isIn(i)) g(i); });
+  } else {
+    parallel_for (long i=0; i<m; i++) g(vs.vtx(i));
+  }
+}
+
+// Decides on sparse or dense base on number of nonzeros in the active
+// vertices, or with the graph's direction policy (see direction.h) unless
+// a threshold is given. then is the epilogue and prologue of edgeMapThen.
+template <class data, class vertex, class VS, class F, class T = noThen>
 vertexSubsetData<data> edgeMapData(graph<vertex>& GA, VS &vs, F f,
-    intT threshold = -1, const flags& fl=0) {
+    intT threshold = -1, const flags& fl=0, T then = T()) {
+  ioScope scope("edgeMap");
   long numVertices = GA.n, numEdges = GA.m, m = vs.numNonzeros();
+  scope.frontier = m;
+  directionPolicy* DP = threshold == -1 ? GA.DP : NULL;
   if(threshold == -1) threshold = numEdges/20; //default threshold
   vertex *G = GA.V;
   if (numVertices != vs.numRows()) {
     cout << "edgeMap: Sizes Don't match" << endl;
     abort();
   }
+  //the asynchronous edgeMap has no output to apply the epilogue to
+  if ((fl & asynchronous) && has_then<T>::value) {
+    cout << "edgeMap: asynchronous does not support the epilogue of edgeMapThen" << endl;
+    abort();
+  }
   if (m == 0) return vertexSubsetData<data>(numVertices);
   uintT* degrees = NULL;
-  vertex* frontierVertices = NULL;
   uintT outDegrees = 0;
-  if(threshold > 0) { //compute sum of out-degrees if threshold > 0 
+  if(threshold > 0 || DP != NULL) { //compute sum of out-degrees if threshold > 0
     vs.toSparse();
-    degrees = newA(uintT, m);
-    frontierVertices = newA(vertex,m);
+    degrees = newPoolA(uintT, m);
     {parallel_for (size_t i=0; i < m; i++) {
-	uintE v_id = vs.vtx(i);
-	vertex v = G[v_id];
-	degrees[i] = v.getOutDegree();
-	frontierVertices[i] = v;
+        uintE v = vs.vtx(i);
+	degrees[i] = G[v].getOutDegree();
+        applyPre(then, v, has_pre<T>());
       }}
     outDegrees = sequence::plusReduce(degrees, m);
+    scope.edges = outDegrees;
     if (outDegrees == 0) return vertexSubsetData<data>(numVertices);
+  } else if (has_pre<T>::value) {
+    forEachIn(vs, [&] (uintE v) { applyPre(then, v, has_pre<T>()); });
   }
-  if (!(fl & no_dense) && m + outDegrees > threshold) {
-    if(degrees) free(degrees);
-    if(frontierVertices) free(frontierVertices);
+  //the output of the edgeMaps that do not apply then themselves
+  auto thenPass = [&] (vertexSubsetData<data>& out) {
+    if (has_then<T>::value)
+      forEachIn(out, [&] (uintE v) { applyThen(then, v, has_then<T>()); });
+  };
+  //the semi-external mode stages the frontier's edges for one round, so
+  //it runs the edgeMap level-synchronously, which gives the same result
+  if ((fl & asynchronous) && !(GA.SE != NULL && GA.SE->enabled)) {
+    if (degrees) bigFree(degrees);
+    scope.mode = "async";
+    return edgeMapAsync<data>(GA, vs, f);
+  }
+  if (fl & no_dense) DP = NULL;
+  bool dense = DP != NULL ? DP->choose(m, outDegrees, threshold) :
+    !(fl & no_dense) && m + outDegrees > threshold;
+  //edgeMaps chosen by a policy that is being calibrated are timed
+  timer t;
+  if (DP != NULL && DP->timing()) t.start();
+  //propagation blocking replaces the push (sparse and dense_forward)
+  if ((fl & propagation_blocking) && (!dense || fl & dense_forward) &&
+      !(GA.SE != NULL && GA.SE->enabled)) {
+    if (degrees) bigFree(degrees);
+    scope.mode = "blocked";
+    auto vs_out = edgeMapBlocked<data>(GA, vs, f, fl);
+    thenPass(vs_out);
+    if (t.on) DP->record(t.stop());
+    return vs_out;
+  }
+  if (dense) {
+    if(degrees) bigFree(degrees);
     vs.toDense();
-    return (fl & dense_forward) ?
-      edgeMapDenseForward<data, vertex, VS, F>(GA, vs, f, fl) :
-      edgeMapDense<data, vertex, VS, F>(GA, vs, f, fl);
+    scope.mode = (fl & dense_forward) ? "dense_forward" : "dense";
+    bool advise = GA.SE != NULL && GA.SE->advise;
+    if (advise) GA.SE->adviseAll(MADV_SEQUENTIAL);
+    auto vs_out = denseView(vs, [&] (auto& view) {
+        if (!(fl & dense_forward)) return edgeMapDense<data>(GA, view, f, then, fl);
+        auto out = edgeMapDenseForward<data>(GA, view, f, fl);
+        thenPass(out);
+        return out; });
+    if (advise) GA.SE->adviseAll(MADV_NORMAL);
+    if (t.on) DP->record(t.stop());
+    return vs_out;
   } else {
+    //semi-external mode: read the frontier's edges from the files into
+    //copies of its vertices, otherwise optionally ask the kernel to
+    //prefetch them
+    //local_output takes precedence over sparse_no_filter
+    bool no_filter = should_output(fl) && (fl & sparse_no_filter) && !(fl & local_output);
+    scope.mode = no_filter ? "sparse_no_filter" :
+      should_output(fl) && (fl & local_output) ? "sparse_local" : "sparse";
+    vertex* frontierVertices = NULL;
+    char* staged = NULL;
+    if (GA.SE != NULL && seUncompressed<vertex>::value && (GA.SE->enabled || GA.SE->advise)) {
+      frontierVertices = newPoolA(vertex,m);
+      {parallel_for (size_t i=0; i < m; i++) frontierVertices[i] = G[vs.vtx(i)];}
+      if (GA.SE->enabled) staged = GA.SE->stage(frontierVertices, m, false);
+      else GA.SE->adviseWillNeed(frontierVertices, m, false);
+      if (staged == NULL) { bigFree(frontierVertices); frontierVertices = NULL; }
+    }
     auto vs_out =
-      (should_output(fl) && fl & sparse_no_filter) ? // only call snof when we output
+      no_filter ? // only call snof when we output
       edgeMapSparse_no_filter<data, vertex, VS, F>(GA, frontierVertices, vs, degrees, vs.numNonzeros(), f, fl) :
       edgeMapSparse<data, vertex, VS, F>(GA, frontierVertices, vs, degrees, vs.numNonzeros(), f, fl);
-    free(degrees); free(frontierVertices);
+    thenPass(vs_out);
+    bigFree(degrees);
+    if (frontierVertices != NULL) bigFree(frontierVertices);
+    if (staged != NULL) free(staged);
+    if (t.on) DP->record(t.stop());
     return vs_out;
   }
 }
@@ -282,12 +607,33 @@ vertexSubset edgeMap(graph<vertex>& GA, VS& vs, F f,
   return edgeMapData<pbbs::empty>(GA, vs, f, threshold, fl);
 }
 
+// edgeMap that also calls then(v) on each vertex v of its output (unless
+// it has no_output), and then.pre(u) on each vertex u of vs before any
+// edge is processed if then has such a member. The dense edgeMap applies
+// then to a vertex right after processing its in-edges, and pre runs in
+// the pass computing the frontier's degrees, so that neither takes a
+// separate vertexMap. With output data, pass then to edgeMapData.
+template <class vertex, class VS, class F, class T>
+vertexSubset edgeMapThen(graph<vertex>& GA, VS& vs, F f, T then,
+    intT threshold = -1, const flags& fl=0) {
+  return edgeMapData<pbbs::empty>(GA, vs, f, threshold, fl, then);
+}
+
 // Packs out the adjacency lists of all vertex in vs. A neighbor, ngh, is kept
 // in the new adjacency list if p(ngh) is true.
 // Weighted graphs are not yet supported, but this should be easy to do.
 template <class vertex, class P>
 vertexSubsetData<uintE> packEdges(graph<vertex>& GA, vertexSubset& vs, P& p, const flags& fl=0) {
   using S = tuple<uintE, uintE>;
+  if (GA.readOnly) {
+    cout << "packEdges: the edges are memory-mapped read-only, run without -m" << endl;
+    abort();
+  }
+  if (csrLayout<vertex>::value) {
+    cout << "packEdges: the degrees of the CSR layout cannot change, compile without CSR" << endl;
+    abort();
+  }
+  GA.dropSegments();
   vs.toSparse();
   vertex* G = GA.V; long m = vs.numNonzeros(); long n = vs.numRows();
   if (vs.size() == 0) {
@@ -304,9 +650,9 @@ vertexSubsetData<uintE> packEdges(graph<vertex>& GA, vertexSubset& vs, P& p, con
     outV = newA(S, vs.size());
   }
 
-  bool* bits = newA(bool, outEdgeCount);
-  uintE* tmp1 = newA(uintE, outEdgeCount);
-  uintE* tmp2 = newA(uintE, outEdgeCount);
+  bool* bits = newPoolA(bool, outEdgeCount);
+  uintE* tmp1 = newPoolA(uintE, outEdgeCount);
+  uintE* tmp2 = newPoolA(uintE, outEdgeCount);
   if (should_output(fl)) {
     parallel_for (size_t i=0; i<m; i++) {
       uintE v = vs.vtx(i);
@@ -325,7 +671,7 @@ vertexSubsetData<uintE> packEdges(graph<vertex>& GA, vertexSubset& vs, P& p, con
       size_t ct = G[v].packOutNgh(v, p, bitsOff, tmp1Off, tmp2Off);
     }
   }
-  free(bits); free(tmp1); free(tmp2);
+  bigFree(bits); bigFree(tmp1); bigFree(tmp2);
   if (should_output(fl)) {
     return vertexSubsetData<uintE>(n, m, outV);
   } else {
@@ -374,7 +720,9 @@ vertexSubsetData<uintE> edgeMapFilter(graph<vertex>& GA, vertexSubset& vs, P& p,
 template <class F, class VS, typename std::enable_if<
   !std::is_same<VS, vertexSubset>::value, int>::type=0 >
 void vertexMap(VS& V, F f) {
+  ioScope scope("vertexMap");
   size_t n = V.numRows(), m = V.numNonzeros();
+  scope.frontier = m;
   if(V.dense()) {
     parallel_for(long i=0;i<n;i++) {
       if(V.isIn(i)) {
@@ -391,13 +739,16 @@ void vertexMap(VS& V, F f) {
 template <class VS, class F, typename std::enable_if<
   std::is_same<VS, vertexSubset>::value, int>::type=0 >
 void vertexMap(VS& V, F f) {
+  ioScope scope("vertexMap");
   size_t n = V.numRows(), m = V.numNonzeros();
+  scope.frontier = m;
   if(V.dense()) {
-    parallel_for(long i=0;i<n;i++) {
-      if(V.isIn(i)) {
-        f(i);
-      }
-    }
+    denseView(V, [&] (auto& view) {
+        parallel_for(long i=0;i<n;i++) {
+          if(view.isIn(i)) {
+            f(i);
+          }
+        } });
   } else {
     parallel_for(long i=0;i<m;i++) {
       f(V.vtx(i));
@@ -409,13 +760,19 @@ void vertexMap(VS& V, F f) {
 //input vertexSubset is returned
 template <class F>
 vertexSubset vertexFilter(vertexSubset V, F filter) {
-  long n = V.numRows(), m = V.numNonzeros();
+  long n = V.numRows(), W = bitmap::words(n);
+  bool made = !V.dense() && V.b == NULL; //a bitmap built for this call
   V.toDense();
-  bool* d_out = newA(bool,n);
-  {parallel_for(long i=0;i<n;i++) d_out[i] = 0;}
-  {parallel_for(long i=0;i<n;i++)
-      if(V.d[i]) d_out[i] = filter(i);}
-  return vertexSubset(n,d_out);
+  uint64_t* out = newPoolA(uint64_t,W);
+  {parallel_for(long w=0;w<W;w++) {
+      uint64_t x = 0;
+      long end = min(n, 64*w+64);
+      for (long i=64*w;i<end;i++)
+        if(V.isIn(i) && filter(i)) x |= (uint64_t) 1 << (i&63);
+      out[w] = x;
+    }}
+  if (made) { bigFree(V.b); V.b = NULL; }
+  return vertexSubset::fromBitmap(n,out);
 }
 
 template <class F>
@@ -424,7 +781,7 @@ vertexSubset vertexFilter2(vertexSubset V, F filter) {
   if (m == 0) {
     return vertexSubset(n);
   }
-  bool* bits = newA(bool, m);
+  bool* bits = newPoolA(bool, m);
   V.toSparse();
   {parallel_for(size_t i=0; i<m; i++) {
     uintE v = V.vtx(i);
@@ -434,7 +791,7 @@ vertexSubset vertexFilter2(vertexSubset V, F filter) {
   auto bits_m = make_in_imap<bool>(m, [&] (size_t i) { return bits[i]; });
   auto out = pbbs::pack(v_imap, bits_m);
   out.alloc = false;
-  free(bits);
+  bigFree(bits);
   return vertexSubset(n, out.size(), out.s);
 }
 
@@ -444,7 +801,7 @@ vertexSubset vertexFilter2(vertexSubsetData<data> V, F filter) {
   if (m == 0) {
     return vertexSubset(n);
   }
-  bool* bits = newA(bool, m);
+  bool* bits = newPoolA(bool, m);
   V.toSparse();
   parallel_for(size_t i=0; i<m; i++) {
     auto t = V.vtxAndData(i);
@@ -454,7 +811,7 @@ vertexSubset vertexFilter2(vertexSubsetData<data> V, F filter) {
   auto bits_m = make_in_imap<bool>(m, [&] (size_t i) { return bits[i]; });
   auto out = pbbs::pack(v_imap, bits_m);
   out.alloc = false;
-  free(bits);
+  bigFree(bits);
   return vertexSubset(n, out.size(), out.s);
 }
 
@@ -469,6 +826,32 @@ void Compute(graph<vertex>&, commandLine);
 template<class vertex>
 void Compute(hypergraph<vertex>&, commandLine);
 
+// Runs one round of the application, recorded as a "round" event when
+// -stats is given.
+template<class G>
+void computeRound(G& GA, commandLine P) {
+  _ioStats.nextRound();
+  ioScope scope("round");
+  Compute(GA,P);
+}
+
+// Sets the direction policy of edgeMap from -dir, -alpha, -beta and
+// -dirlog (see direction.h); without them the fixed threshold is used.
+template<class G>
+void setDirection(G& GA, commandLine& P) {
+  char* mode = P.getOptionValue("-dir");
+  bool log = P.getOptionValue("-dirlog");
+  if (mode == NULL && !log) return;
+  GA.DP = new directionPolicy(GA.n, GA.m);
+  if (mode != NULL && !GA.DP->setMode(mode)) {
+    cout << "Unknown -dir mode " << mode << endl;
+    abort();
+  }
+  GA.DP->alpha = P.getOptionDoubleValue("-alpha", DIR_ALPHA);
+  GA.DP->beta = P.getOptionDoubleValue("-beta", DIR_BETA);
+  GA.DP->log = log;
+}
+
 int parallel_main(int argc, char* argv[]) {
   commandLine P(argc,argv," [-s] <inFile>");
   char* iFile = P.getArgument(0);
@@ -476,6 +859,18 @@ int parallel_main(int argc, char* argv[]) {
   bool compressed = P.getOptionValue("-c");
   bool binary = P.getOptionValue("-b");
   bool mmap = P.getOptionValue("-m");
+  bool semiExt = P.getOptionValue("-se");
+  bool advise = P.getOptionValue("-advise");
+  bool numa = P.getOptionValue("-numa");
+  bool segment = P.getOptionValue("-segment");
+  long segSize = P.getOptionLongValue("-segsize",0);
+  char* statsFile = P.getOptionValue("-stats");
+  if (statsFile != NULL) _ioStats.open(statsFile);
+  char* allocMode = P.getOptionValue("-alloc");
+  if (allocMode != NULL && !_bigAlloc.setMode(allocMode)) {
+    cout << "Unknown -alloc mode " << allocMode << endl;
+    abort();
+  }
   //cout << "mmap = " << mmap << endl;
   long rounds = P.getOptionLongValue("-rounds",3);
   if (compressed) {
@@ -483,14 +878,19 @@ int parallel_main(int argc, char* argv[]) {
 #ifndef HYPER
       graph<compressedSymmetricVertex> G =
         readCompressedGraph<compressedSymmetricVertex>(iFile,symmetric,mmap); //symmetric graph
+      if (semiExt) G.enableSemiExternal();
+      if (advise) G.enableAdvice();
+      if (numa) G.enableNuma();
+      if (segment) G.enableSegments(segSize);
+      setDirection(G,P);
 #else
       hypergraph<compressedSymmetricVertex> G =
         readCompressedHypergraph<compressedSymmetricVertex>(iFile,symmetric,mmap); //symmetric graph
 #endif
-      Compute(G,P);
+      computeRound(G,P);
       for(int r=0;r<rounds;r++) {
         startTime();
-        Compute(G,P);
+        computeRound(G,P);
         nextTime("Running time");
       }
       G.del();
@@ -498,15 +898,20 @@ int parallel_main(int argc, char* argv[]) {
 #ifndef HYPER
       graph<compressedAsymmetricVertex> G =
         readCompressedGraph<compressedAsymmetricVertex>(iFile,symmetric,mmap); //asymmetric graph
+      if (semiExt) G.enableSemiExternal();
+      if (advise) G.enableAdvice();
+      if (numa) G.enableNuma();
+      if (segment) G.enableSegments(segSize);
+      setDirection(G,P);
 #else
       hypergraph<compressedAsymmetricVertex> G =
         readCompressedHypergraph<compressedAsymmetricVertex>(iFile,symmetric,mmap); //asymmetric graph
 #endif
-      Compute(G,P);
+      computeRound(G,P);
       if(G.transposed) G.transpose();
       for(int r=0;r<rounds;r++) {
         startTime();
-        Compute(G,P);
+        computeRound(G,P);
         nextTime("Running time");
         if(G.transposed) G.transpose();
       }
@@ -515,23 +920,33 @@ int parallel_main(int argc, char* argv[]) {
   } else {
     if (symmetric) {
 #ifndef HYPER
-      graph<symmetricVertex> G =
-        readGraph<symmetricVertex>(iFile,compressed,symmetric,binary,mmap); //symmetric graph
+      graph<uncompressedSymmetricVertex> G =
+        readGraph<uncompressedSymmetricVertex>(iFile,compressed,symmetric,binary,mmap); //symmetric graph
+      if (semiExt) G.enableSemiExternal();
+      if (advise) G.enableAdvice();
+      if (numa) G.enableNuma();
+      if (segment) G.enableSegments(segSize);
+      setDirection(G,P);
 #else
       hypergraph<symmetricVertex> G =
         readHypergraph<symmetricVertex>(iFile,compressed,symmetric,binary,mmap); //symmetric graph
 #endif
-      Compute(G,P);
+      computeRound(G,P);
       for(int r=0;r<rounds;r++) {
         startTime();
-        Compute(G,P);
+        computeRound(G,P);
         nextTime("Running time");
       }
       G.del();
     } else {
 #ifndef HYPER
-      graph<asymmetricVertex> G =
-        readGraph<asymmetricVertex>(iFile,compressed,symmetric,binary,mmap); //asymmetric graph
+      graph<uncompressedAsymmetricVertex> G =
+        readGraph<uncompressedAsymmetricVertex>(iFile,compressed,symmetric,binary,mmap); //asymmetric graph
+      if (semiExt) G.enableSemiExternal();
+      if (advise) G.enableAdvice();
+      if (numa) G.enableNuma();
+      if (segment) G.enableSegments(segSize);
+      setDirection(G,P);
 #else
       hypergraph<asymmetricVertex> G =
         readHypergraph<asymmetricVertex>(iFile,compressed,symmetric,binary,mmap); //asymmetric graph
@@ -540,12 +955,13 @@ int parallel_main(int argc, char* argv[]) {
       // if(G.transposed) G.transpose();
       for(int r=0;r<rounds;r++) {
         startTime();
-        Compute(G,P);
+        computeRound(G,P);
         nextTime("Running time");
         if(G.transposed) G.transpose();
       }
       G.del();
     }
   }
+  _ioStats.close();
 }
 #endif
@@ -106,7 +106,7 @@ inline uintE decode_next_edge(uchar* &start, long* location) {
 */
 template <class T>
   inline void decode(T t, uchar* edgeArr, const uintE &source, const uintT &degree, const bool par=true) {
-  uintE edgesRead = 0;
+  uintT edgesRead = 0;
   long location = 0;
   if (degree > 0) {
     uintE startEdge = decode_first_edge(edgeArr, &location, source);
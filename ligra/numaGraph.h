@@ -0,0 +1,205 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// NUMA-aware mode (-numa). The vertices are split into one contiguous
+// range per NUMA node, balanced by in-degree, since dense (pull)
+// iterations read the in-edges of each destination. The pages of each
+// range of the vertex array, of its edges (uncompressed graphs) and of
+// per-vertex arrays passed to graph::numaPlace() are bound to the node
+// with mbind, the worker threads are pinned to the CPUs of the nodes,
+// and forVertices() has the threads of each node process the vertices
+// of its range first, taking chunks of other ranges once it is done.
+// Nodes are read from /sys/devices/system/node, and mbind is called
+// directly so that libnuma is not needed. Pinning and node-local
+// execution need the OpenMP build; other builds only place the pages.
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include "parallel.h"
+#include "utils.h"
+using namespace std;
+
+#define NUMA_MPOL_BIND 2
+#define NUMA_MPOL_MF_MOVE (1<<1)
+#define NUMA_CHUNK 256
+#define NUMA_MAX_NODES 64
+
+struct numaPartitions {
+  int parts;
+  vector<int> node;          //node of each partition
+  vector<vector<int> > cpus; //CPUs of each partition's node
+  vector<long> start;        //partition p owns vertices [start[p], start[p+1])
+  long* next;                //next unclaimed vertex of each partition (padded)
+  long failed;               //number of mbind calls that failed
+
+  numaPartitions() : parts(0), next(NULL), failed(0) {}
+
+  //parses a cpulist such as "0-3,8-11"
+  static vector<int> parseCpuList(const string& s) {
+    vector<int> r;
+    size_t i = 0;
+    while (i < s.size()) {
+      size_t j = s.find(',', i);
+      if (j == string::npos) j = s.size();
+      string item = s.substr(i, j-i);
+      size_t dash = item.find('-');
+      if (item.size() > 0) {
+        int lo = atoi(item.c_str());
+        int hi = dash == string::npos ? lo : atoi(item.c_str()+dash+1);
+        for (int c = lo; c <= hi; c++) r.push_back(c);
+      }
+      i = j+1;
+    }
+    return r;
+  }
+
+  //finds the NUMA nodes that have CPUs; with _parts > 0, that many
+  //partitions are used, assigned to the nodes round-robin. Returns
+  //false if there is only one partition.
+  bool init(int _parts) {
+    vector<int> ids;
+    vector<vector<int> > nodeCpus;
+    for (int i = 0; i < NUMA_MAX_NODES; i++) {
+      string path = "/sys/devices/system/node/node" + to_string(i) + "/cpulist";
+      ifstream in(path.c_str());
+      if (!in.is_open()) continue;
+      string list;
+      getline(in, list);
+      vector<int> c = parseCpuList(list);
+      if (c.size() > 0) { ids.push_back(i); nodeCpus.push_back(c); }
+    }
+    if (ids.size() == 0) return false;
+    parts = _parts > 0 ? _parts : ids.size();
+    if (parts < 2) return false;
+    for (int p = 0; p < parts; p++) {
+      node.push_back(ids[p % ids.size()]);
+      cpus.push_back(nodeCpus[p % ids.size()]);
+    }
+    next = newA(long, 8*parts);
+    return true;
+  }
+
+  //splits the vertices into parts ranges of about equal in-degree + 1
+  template <class vertex>
+  void split(vertex* V, long n) {
+    long* sums = newA(long, n+1);
+    {parallel_for(long i=0;i<n;i++) sums[i] = V[i].getInDegree() + 1;}
+    sums[n] = 0;
+    long total = sequence::plusScan(sums, sums, n+1);
+    start.resize(parts+1);
+    start[0] = 0;
+    for (int p = 1; p < parts; p++) {
+      long target = total / parts * p;
+      start[p] = upper_bound(sums, sums+n, target) - sums - 1;
+      if (start[p] < start[p-1]) start[p] = start[p-1];
+    }
+    start[parts] = n;
+    free(sums);
+  }
+
+  //binds the whole pages in [A, A+len) to the node of partition p
+  void bind(void* A, size_t len, int p) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t lo = ((size_t) A + page - 1) / page * page;
+    size_t hi = ((size_t) A + len) / page * page;
+    if (hi <= lo) return;
+    unsigned long mask[NUMA_MAX_NODES/64] = {0};
+    mask[node[p]/64] |= 1UL << (node[p] % 64);
+    if (syscall(SYS_mbind, lo, hi-lo, NUMA_MPOL_BIND, mask, NUMA_MAX_NODES+1,
+                NUMA_MPOL_MF_MOVE) != 0) failed++;
+  }
+
+  //binds the range of each partition of a per-vertex array
+  void place(void* A, size_t elemSize) {
+    for (int p = 0; p < parts; p++)
+      bind((char*) A + start[p]*elemSize, (start[p+1]-start[p])*elemSize, p);
+  }
+
+  //binds the in- or out-edges of each partition, for graphs whose edges
+  //are stored in vertex order with edgeBytes bytes per edge
+  template <class vertex>
+  void placeEdges(vertex* V, bool in, size_t edgeBytes) {
+    for (int p = 0; p < parts; p++) {
+      long first = start[p], last = start[p+1]-1;
+      while (first <= last && (in ? V[first].getInDegree() : V[first].getOutDegree()) == 0) first++;
+      while (last >= first && (in ? V[last].getInDegree() : V[last].getOutDegree()) == 0) last--;
+      if (first > last) continue;
+      char* lo = (char*) (in ? V[first].getInNeighbors() : V[first].getOutNeighbors());
+      char* hi = (char*) (in ? V[last].getInNeighbors() : V[last].getOutNeighbors()) +
+        (in ? V[last].getInDegree() : V[last].getOutDegree())*edgeBytes;
+      if (hi > lo) bind(lo, hi-lo, p);
+    }
+  }
+
+  //pins each worker thread to the CPUs of its partition's node
+  void pinWorkers() {
+#ifdef OPENMP
+    #pragma omp parallel
+    {
+      int t = omp_get_thread_num(), T = omp_get_num_threads();
+      int p = (int) ((long) t * parts / T);
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      for (size_t c = 0; c < cpus[p].size(); c++) CPU_SET(cpus[p][c], &set);
+      sched_setaffinity(0, sizeof(set), &set);
+    }
+#endif
+  }
+
+  //applies f to every vertex, each worker taking chunks of its own
+  //partition before helping with the others
+  template <class F>
+  void forVertices(F f) {
+#ifdef OPENMP
+    for (int p = 0; p < parts; p++) next[8*p] = start[p];
+    #pragma omp parallel
+    {
+      int t = omp_get_thread_num(), T = omp_get_num_threads();
+      int home = (int) ((long) t * parts / T);
+      for (int k = 0; k < parts; k++) {
+        int p = (home + k) % parts;
+        while (1) {
+          long s = __sync_fetch_and_add(&next[8*p], NUMA_CHUNK);
+          if (s >= start[p+1]) break;
+          long e = min(s + NUMA_CHUNK, start[p+1]);
+          for (long v = s; v < e; v++) f(v);
+        }
+      }
+    }
+#else
+    long n = start[parts];
+    parallel_for(long v=0;v<n;v++) f(v);
+#endif
+  }
+
+  void del() { if (next != NULL) free(next); }
+};
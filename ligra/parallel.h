@@ -37,6 +37,9 @@
 static int getWorkers() {
   return __cilkrts_get_nworkers();
 }
+static int getWorkerNum() {
+  return __cilkrts_get_worker_number();
+}
 static void setWorkers(int n) {
   __cilkrts_end_cilk();
   //__cilkrts_init();
@@ -61,6 +64,9 @@ static void setWorkers(int n) {
 static int getWorkers() {
   return __cilkrts_get_nworkers();
 }
+static int getWorkerNum() {
+  return __cilkrts_get_worker_number();
+}
 static void setWorkers(int n) {
   __cilkrts_end_cilk();
   //__cilkrts_init();
@@ -82,6 +88,11 @@ static void setWorkers(int n) {
 #define parallel_for_256 _Pragma("omp parallel for schedule (static,256)") for
 static int getWorkers() { return omp_get_max_threads(); }
 static void setWorkers(int n) { omp_set_num_threads(n); }
+//taken from the outermost parallel region, since nested (inactive) ones
+//number their single thread 0
+static int getWorkerNum() {
+  return omp_get_level() > 0 ? omp_get_ancestor_thread_num(1) : 0;
+}
 
 // c++
 #else
@@ -94,6 +105,7 @@ static void setWorkers(int n) { omp_set_num_threads(n); }
 #define cilk_for for
 static int getWorkers() { return 1; }
 static void setWorkers(int n) { }
+static int getWorkerNum() { return 0; }
 
 #endif
 
@@ -0,0 +1,177 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Segmented (cache-blocked) in-edges for dense edgeMaps (-segment), as
+// in Cagra. The sources are split into ranges of segSize vertices, and
+// the in-edges of uncompressed graphs are copied once, when the option
+// is given, into one CSR per range: the destinations that have in-edges
+// from the range, each with those sources. Dense (pull) edgeMaps then
+// process one segment at a time, so that the frontier and the source
+// values read by update() come from a slice of the vertices that fits
+// in the last-level cache, while the destinations are visited in order.
+// Segments run one after the other, each one in parallel over its
+// destinations, so each destination is updated by one thread at a time
+// and its partial results from the segments add up in place. By default
+// a segment holds as many sources as half of the last-level cache can
+// hold at SEG_SOURCE_BYTES bytes per source (a frontier flag and a value
+// per source); -segsize sets it in vertices.
+#pragma once
+#include <iostream>
+#include <vector>
+#include <type_traits>
+#include <unistd.h>
+#include "parallel.h"
+#include "utils.h"
+#include "bigAlloc.h"
+#include "vertex.h"
+#include "csrVertex.h"
+using namespace std;
+
+//vertices per block when partitioning the edges by segment
+#define SEG_BLOCK 4096
+//LLC size assumed when sysconf does not report it
+#define SEG_DEFAULT_LLC (8L << 20)
+//bytes of per-vertex data read from the sources of a segment
+#define SEG_SOURCE_BYTES 9
+
+struct segmentedEdges {
+  long n, segs, segSize;
+  bool transposed;  //orientation of the graph the segments were built for
+  long* segDests;   //segment k has destinations segDests[k]..segDests[k+1]-1
+  uintE* dests;     //destination j of all segments
+  uintT* offsets;   //its sources are srcs[offsets[j]..offsets[j+1]-1]
+  uintE* srcs;
+#ifdef WEIGHTED
+  weightT* weights;
+#endif
+
+  segmentedEdges() : n(0), segs(0), segSize(0), transposed(0), segDests(NULL),
+    dests(NULL), offsets(NULL), srcs(NULL) {}
+
+  //sources per segment filling half of the last-level cache
+  static long defaultSize() {
+    long llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (llc <= 0) llc = SEG_DEFAULT_LLC;
+    return max(llc / 2 / SEG_SOURCE_BYTES, 64L);
+  }
+
+  //compressed graphs are not segmented
+  template <class vertex>
+  void build(vertex* V, long _n, long m, long _segSize, bool _transposed,
+             false_type) {}
+
+  //copies the in-edges of V into segments of _segSize sources
+  template <class vertex>
+  void build(vertex* V, long _n, long m, long _segSize, bool _transposed,
+             true_type) {
+    n = _n; segSize = _segSize; transposed = _transposed;
+    segs = (n + segSize - 1) / segSize;
+    long nb = (n + SEG_BLOCK - 1) / SEG_BLOCK;
+    //edges of each (segment, block) pair, segment-major
+    long* cts = newA(long, segs*nb+1);
+    {parallel_for(long i=0;i<segs*nb+1;i++) cts[i] = 0;}
+    {parallel_for(long b=0;b<nb;b++) {
+      for (long v=b*SEG_BLOCK; v<min(n,(b+1)*SEG_BLOCK); v++) {
+        uintT d = V[v].getInDegree();
+        for (uintT j=0; j<d; j++) cts[(V[v].getInNeighbor(j)/segSize)*nb+b]++;
+      }
+      }}
+    sequence::plusScan(cts, cts, segs*nb+1);
+
+    //in each segment, the edges are in order of destination
+    srcs = newBigA(uintE, m);
+#ifdef WEIGHTED
+    weights = newBigA(weightT, m);
+#endif
+    uintE* edgeDests = newA(uintE, m);
+    {parallel_for(long b=0;b<nb;b++) {
+      vector<long> pos(segs);
+      for (long k=0; k<segs; k++) pos[k] = cts[k*nb+b];
+      for (long v=b*SEG_BLOCK; v<min(n,(b+1)*SEG_BLOCK); v++) {
+        uintT d = V[v].getInDegree();
+        for (uintT j=0; j<d; j++) {
+          uintE u = V[v].getInNeighbor(j);
+          long p = pos[u/segSize]++;
+          srcs[p] = u;
+          edgeDests[p] = v;
+#ifdef WEIGHTED
+          weights[p] = V[v].getInWeight(j);
+#endif
+        }
+      }
+      }}
+
+    //one destination entry per run of edges with the same destination
+    uintT* first = newA(uintT, m+1);
+    {parallel_for(long i=0;i<m;i++)
+        first[i] = i == 0 || edgeDests[i] != edgeDests[i-1] ||
+          srcs[i]/segSize != srcs[i-1]/segSize;}
+    first[m] = 0;
+    long D = sequence::plusScan(first, first, m+1);
+    dests = newBigA(uintE, D);
+    offsets = newBigA(uintT, D+1);
+    {parallel_for(long i=0;i<m;i++)
+        if (first[i+1] != first[i]) {
+          dests[first[i]] = edgeDests[i];
+          offsets[first[i]] = i;
+        }}
+    offsets[D] = m;
+    segDests = newA(long, segs+1);
+    for (long k=0; k<segs; k++) segDests[k] = first[cts[k*nb]];
+    segDests[segs] = D;
+    free(first); free(edgeDests); free(cts);
+  }
+
+  //dense edgeMap over the segments; like decodeInNghBreakEarly, stops
+  //reading the in-edges of a destination once cond is false
+  template <class VS, class F, class G>
+  void pull(VS& vs, F& f, G& g) {
+    for (long k=0; k<segs; k++) {
+      parallel_for (long j=segDests[k]; j<segDests[k+1]; j++) {
+        uintE v = dests[j];
+        if (!checkCond(f, v)) continue;
+        for (uintT e=offsets[j]; e<offsets[j+1]; e++) {
+          uintE u = srcs[e];
+          if (vs.isIn(u)) {
+#ifndef WEIGHTED
+            auto m = f.update(u, v);
+#else
+            auto m = f.update(u, v, weights[e]);
+#endif
+            g(v, m);
+          }
+          if (breakEarly<F>::value && !f.cond(v)) break;
+        }
+      }
+    }
+  }
+
+  void del() {
+    if (srcs == NULL) return;
+    free(segDests); bigFree(dests); bigFree(offsets); bigFree(srcs);
+#ifdef WEIGHTED
+    bigFree(weights);
+#endif
+  }
+};
@@ -0,0 +1,324 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Semi-external edgeMap support. A graph loaded with -m records the
+// read-only mappings of the files holding its edges. When the
+// semi-external mode is enabled (-se), the vertex arrays stay in memory
+// and edgeMap reads the edges it needs from those files with large
+// aligned pread()s issued in parallel, instead of faulting the mapped
+// pages in one at a time in random order:
+//
+// - sparse edgeMaps sort the frontier by edge offset, coalesce the
+//   adjacency ranges into page-aligned chunks and read them into a
+//   buffer that the frontier vertices are repointed to;
+// - dense edgeMaps stream the edge array in blocks of SE_BLOCK_SIZE
+//   bytes, reading only the edges of the vertices visited in the block.
+//
+// Edges that do not live in a mapped file (e.g. in-edges built at load
+// time) are used in place. Compressed graphs are not staged.
+//
+// Alternatively (-advise), edgeMap keeps using the mappings but tells
+// the kernel what it is about to read: madvise(MADV_WILLNEED) on the
+// coalesced page spans of the frontier's edges before a sparse
+// iteration, and MADV_SEQUENTIAL on the mappings during dense
+// iterations.
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdlib.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "parallel.h"
+#include "utils.h"
+#include "quickSort.h"
+#include "vertex.h"
+using namespace std;
+
+#define SE_ALIGN 4096
+//each pread reads at most this many bytes
+#define SE_IO_SIZE (1 << 20)
+//ranges less than this many bytes apart are read together
+#define SE_MERGE_GAP (1 << 16)
+//dense edgeMaps read the edges in blocks of about this many bytes
+#define SE_BLOCK_SIZE (1L << 28)
+
+//bytes per edge of the neighbor arrays (only the IDs with SOA)
+#if !defined(WEIGHTED) || defined(SOA)
+#define SE_EDGE_BYTES sizeof(uintE)
+#else
+#define SE_EDGE_BYTES (2*sizeof(intE))
+#endif
+
+//only the uncompressed vertices store their edges as fixed-size arrays;
+//with weights in separate arrays (SOA) only the IDs would be staged, so
+//the mode is not used for them
+template <class vertex> struct seUncompressed { static const bool value = false; };
+#if !defined(WEIGHTED) || !defined(SOA)
+template <> struct seUncompressed<symmetricVertex> { static const bool value = true; };
+template <> struct seUncompressed<asymmetricVertex> { static const bool value = true; };
+#endif
+
+struct seFile {
+  string name;
+  char* base;
+  size_t size;
+  int fd;
+};
+
+//adjacency range of vertex id, at byte offset start of file
+struct seRange {
+  long file;
+  size_t start;
+  size_t len;
+  long id;
+};
+
+struct seRangeCmp {
+  bool operator() (const seRange& a, const seRange& b) {
+    return a.file < b.file || (a.file == b.file && a.start < b.start);
+  }
+};
+
+//page-aligned span [start, end) of file, at bufOff in the read buffer
+struct seChunk {
+  long file;
+  size_t start, end, bufOff;
+};
+
+struct semiExternal {
+  vector<seFile> files;
+  bool enabled, advise;
+
+  semiExternal() : enabled(0), advise(0) {}
+
+  void addFile(const char* name, char* base, size_t size) {
+    seFile F = {string(name), base, size, -1};
+    files.push_back(F);
+  }
+
+  //opens the files for reading, bypassing the page cache with O_DIRECT
+  //when the file system supports it
+  void enable() {
+    for (size_t i = 0; i < files.size(); i++) {
+      int fd = open(files[i].name.c_str(), O_RDONLY | O_DIRECT);
+      if (fd == -1) fd = open(files[i].name.c_str(), O_RDONLY);
+      if (fd == -1) {
+        perror("open");
+        exit(-1);
+      }
+      files[i].fd = fd;
+    }
+    enabled = 1;
+  }
+
+  void del() {
+    for (size_t i = 0; i < files.size(); i++)
+      if (files[i].fd != -1) close(files[i].fd);
+  }
+
+  long find(const char* p) const {
+    for (size_t i = 0; i < files.size(); i++)
+      if (p >= files[i].base && p < files[i].base + files[i].size) return i;
+    return -1;
+  }
+
+  // Coalesces the k ranges in R, sorted by file and offset, into
+  // page-aligned chunks, merging ranges less than SE_MERGE_GAP bytes
+  // apart. Sets chunkOf[i] to the chunk holding range i.
+  vector<seChunk> coalesce(seRange* R, long k, long* chunkOf) {
+    vector<seChunk> C;
+    for (long i = 0; i < k; i++) {
+      size_t s = R[i].start & ~((size_t)SE_ALIGN-1);
+      size_t e = (R[i].start + R[i].len + SE_ALIGN - 1) & ~((size_t)SE_ALIGN-1);
+      if (!C.empty() && C.back().file == R[i].file && s <= C.back().end + SE_MERGE_GAP) {
+        if (e > C.back().end) C.back().end = e;
+      } else {
+        seChunk c = {R[i].file, s, e, 0};
+        C.push_back(c);
+      }
+      chunkOf[i] = C.size()-1;
+    }
+    return C;
+  }
+
+  // Returns the adjacency ranges of the vertices in V that are stored in
+  // the mapped files (and have keep[i] set, if keep is not NULL), sorted
+  // by file and offset, in R[skip..k). The caller frees R.
+  template <class vertex>
+  seRange* ranges(vertex* V, long k, bool in, bool* keep, long& skip) {
+    seRange* R = newA(seRange, k);
+    parallel_for (long i = 0; i < k; i++) {
+      char* p = (char*) (in ? V[i].getInNeighbors() : V[i].getOutNeighbors());
+      size_t d = in ? V[i].getInDegree() : V[i].getOutDegree();
+      long f = (d == 0 || (keep != NULL && !keep[i])) ? -1 : find(p);
+      R[i].file = f;
+      R[i].start = (f == -1) ? 0 : p - files[f].base;
+      R[i].len = d*SE_EDGE_BYTES;
+      R[i].id = i;
+    }
+    quickSort(R, k, seRangeCmp());
+    skip = 0;
+    while (skip < k && R[skip].file == -1) skip++;
+    return R;
+  }
+
+  // Reads the k ranges in R, sorted by file and offset, into one buffer
+  // and sets pos[i] to the copy of range i. The coalesced chunks are
+  // read with parallel preads of at most SE_IO_SIZE bytes. Returns the
+  // buffer, to be freed by the caller.
+  char* read(seRange* R, long k, char** pos) {
+    long* chunkOf = newA(long, k);
+    vector<seChunk> C = coalesce(R, k, chunkOf);
+    size_t total = 0;
+    long numPieces = 0;
+    for (size_t j = 0; j < C.size(); j++) {
+      C[j].bufOff = total;
+      total += C[j].end - C[j].start;
+      numPieces += (C[j].end - C[j].start + SE_IO_SIZE - 1)/SE_IO_SIZE;
+    }
+    char* buf = NULL;
+    if (posix_memalign((void**)&buf, SE_ALIGN, total > 0 ? total : SE_ALIGN) != 0) {
+      cout << "semiExternal: cannot allocate " << total << " bytes" << endl;
+      abort();
+    }
+
+    struct piece { int fd; size_t off, len; char* dst; };
+    piece* P = newA(piece, numPieces);
+    long p = 0;
+    for (size_t j = 0; j < C.size(); j++) {
+      for (size_t o = C[j].start; o < C[j].end; o += SE_IO_SIZE) {
+        piece q = {files[C[j].file].fd, o, min((size_t)SE_IO_SIZE, C[j].end - o),
+                   buf + C[j].bufOff + (o - C[j].start)};
+        P[p++] = q;
+      }
+    }
+    parallel_for (long j = 0; j < numPieces; j++) {
+      size_t r = 0;
+      while (r < P[j].len) {
+        ssize_t got = pread(P[j].fd, P[j].dst + r, P[j].len - r, P[j].off + r);
+        if (got < 0) {
+          perror("pread");
+          exit(-1);
+        }
+        if (got == 0) break; //the last chunk is rounded up past the end of the file
+        r += got;
+      }
+    }
+    parallel_for (long i = 0; i < k; i++) {
+      seChunk& c = C[chunkOf[i]];
+      pos[i] = buf + c.bufOff + (R[i].start - c.start);
+    }
+    free(P); free(chunkOf);
+    return buf;
+  }
+
+  // Reads the in-edges (in = true) or out-edges of the k vertices in V
+  // that are stored in the mapped files (and have keep[i] set, if keep
+  // is not NULL), and repoints them to the copies. Returns the buffer
+  // holding the copies, to be freed by the caller, or NULL if nothing
+  // was read.
+  template <class vertex>
+  char* stage(vertex* V, long k, bool in, bool* keep = NULL) {
+    if (!seUncompressed<vertex>::value) return NULL;
+    long skip;
+    seRange* R = ranges(V, k, in, keep, skip);
+    if (skip == k) { free(R); return NULL; }
+    long numRead = k - skip;
+    char** pos = newA(char*, numRead);
+    char* buf = read(R + skip, numRead, pos);
+    parallel_for (long i = 0; i < numRead; i++) {
+      vertex& v = V[R[skip+i].id];
+      if (in) v.setInNeighbors((decltype(v.getInNeighbors())) pos[i]);
+      else v.setOutNeighbors((decltype(v.getOutNeighbors())) pos[i]);
+    }
+    free(pos); free(R);
+    return buf;
+  }
+
+  // Asks the kernel to read ahead the page spans holding the in-edges
+  // (in = true) or out-edges of the k vertices in V.
+  template <class vertex>
+  void adviseWillNeed(vertex* V, long k, bool in) {
+    if (!seUncompressed<vertex>::value) return;
+    long skip;
+    seRange* R = ranges(V, k, in, (bool*) NULL, skip);
+    if (skip < k) {
+      long* chunkOf = newA(long, k - skip);
+      vector<seChunk> C = coalesce(R + skip, k - skip, chunkOf);
+      parallel_for (size_t j = 0; j < C.size(); j++) {
+        seFile& F = files[C[j].file];
+        size_t end = min(C[j].end, (F.size + SE_ALIGN - 1) & ~((size_t)SE_ALIGN-1));
+        madvise(F.base + C[j].start, end - C[j].start, MADV_WILLNEED);
+      }
+      free(chunkOf);
+    }
+    free(R);
+  }
+
+  //sets the access pattern of all mapped files, e.g. MADV_SEQUENTIAL
+  //for a dense iteration and MADV_NORMAL after it
+  void adviseAll(int advice) {
+    for (size_t i = 0; i < files.size(); i++)
+      madvise(files[i].base, files[i].size, advice);
+  }
+
+  // Calls visit(v, V) for every vertex v of G with keep(v) true, where
+  // V is a copy of G[v] whose in-edges (in = true) or out-edges are
+  // read from the files. The vertices are processed in blocks of about
+  // SE_BLOCK_SIZE bytes of edges, so the edges are streamed once in
+  // order.
+  template <class vertex, class K, class Vis>
+  void forBlocks(vertex* G, long n, bool in, K keep, Vis visit) {
+    long* sums = newA(long, n+1);
+    {parallel_for (long i = 0; i < n; i++)
+        sums[i] = (in ? G[i].getInDegree() : G[i].getOutDegree())*SE_EDGE_BYTES;}
+    sums[n] = 0;
+    sequence::plusScan(sums, sums, n+1);
+    long s = 0;
+    while (s < n) {
+      //end the block at the first vertex starting SE_BLOCK_SIZE bytes
+      //later, but take at least one vertex
+      long e = std::upper_bound(sums+s, sums+n, sums[s] + SE_BLOCK_SIZE) - sums;
+      if (e == s) e = s+1;
+      long k = e - s;
+      vertex* B = newA(vertex, k);
+      bool* keepB = newA(bool, k);
+      {parallel_for (long i = 0; i < k; i++) {
+        B[i] = G[s+i];
+        keepB[i] = keep(s+i);
+        }}
+      char* buf = stage(B, k, in, keepB);
+      {parallel_for (long i = 0; i < k; i++)
+          if (keepB[i]) visit(s+i, B[i]);}
+      if (buf != NULL) free(buf);
+      free(B); free(keepB);
+      s = e;
+    }
+    free(sums);
+  }
+};
@@ -1,18 +1,171 @@
 #ifndef VERTEX_H
 #define VERTEX_H
 #include "vertexSubset.h"
+#include <stdint.h>
+#include <type_traits>
 using namespace std;
 
+// Weights of uncompressed weighted graphs. By default they are intE and
+// interleaved with the neighbor IDs (entry 2*j+1 of the neighbor array).
+// With SOA defined, each direction instead has a separate array of
+// weightT parallel to the IDs, so scans that only read the IDs do not
+// pull the weights into cache, and the weights can be narrowed with
+// WEIGHT8 (uint8_t), WEIGHT16 (uint16_t) or WEIGHTFLOAT (float).
+#if defined(WEIGHT8)
+typedef uint8_t weightT;
+#elif defined(WEIGHT16)
+typedef uint16_t weightT;
+#elif defined(WEIGHTFLOAT)
+typedef float weightT;
+#else
+typedef intE weightT;
+#endif
+#if !defined(SOA) && (defined(WEIGHT8) || defined(WEIGHT16) || defined(WEIGHTFLOAT))
+#error "narrow weight types need the SOA layout"
+#endif
+
+// Dense (pull) edgeMaps over a frontier stored as a bitmap test the
+// in-neighbors of a vertex 8 (AVX2) or 16 (AVX-512) at a time: the IDs
+// are loaded, the words of the bitmap holding their bits are gathered,
+// and update is only called on the neighbors whose bits are set, in
+// order, stopping once cond is false. The instruction set is chosen at
+// runtime from the CPU, falling back to the scalar loop. This needs
+// 32-bit IDs stored contiguously (not interleaved with weights), and can
+// be disabled by compiling with NOSIMD defined.
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(EDGELONG) && \
+  (!defined(WEIGHTED) || defined(SOA)) && !defined(NOSIMD)
+#define SIMD_PULL
+#include <immintrin.h>
+#endif
+
+// Optional compile-time properties of edgeMap functors, declared as
+// static constexpr bool members set to true:
+//   cond_always_true  cond always returns true (as with cond_true), so
+//                     the decoders skip it
+//   no_break_early    the dense edgeMap may read all in-edges of a
+//                     destination instead of checking cond after each
+//                     update to stop early
+// Functors without them are handled as before.
+template <class F, class = void>
+struct condAlwaysTrue : std::false_type {};
+template <class F>
+struct condAlwaysTrue<F, typename std::enable_if<
+  std::remove_reference<F>::type::cond_always_true>::type> : std::true_type {};
+
+template <class F, class = void>
+struct noBreakEarly : std::false_type {};
+template <class F>
+struct noBreakEarly<F, typename std::enable_if<
+  std::remove_reference<F>::type::no_break_early>::type> : std::true_type {};
+
+//whether the dense edgeMap checks cond after each update
+template <class F>
+struct breakEarly {
+  static const bool value = !condAlwaysTrue<F>::value && !noBreakEarly<F>::value;
+};
+
+template <class F>
+inline bool checkCond(F& f, uintE v) { return condAlwaysTrue<F>::value || f.cond(v); }
+
 namespace decode_uncompressed {
 
+#ifdef SIMD_PULL
+  //0: scalar, 1: AVX2, 2: AVX-512
+  inline int simdLevel() {
+    static int level = __builtin_cpu_supports("avx512f") ? 2 :
+      __builtin_cpu_supports("avx2") ? 1 : 0;
+    return level;
+  }
+
+  //calls update on the neighbors j+k of v for the bits k set in mask,
+  //returning false once cond(v_id) is false
+  template <class vertex, class F, class G>
+  inline bool pullHits(vertex* v, const uintE* nghs, size_t j, unsigned mask,
+                       long v_id, F& f, G& g) {
+    while (mask) {
+      size_t k = j + __builtin_ctz(mask);
+      mask &= mask - 1;
+#ifndef WEIGHTED
+      auto m = f.update(nghs[k], v_id);
+#else
+      auto m = f.update(nghs[k], v_id, v->getInWeight(k));
+#endif
+      g(v_id, m);
+      if (breakEarly<F>::value && !f.cond(v_id)) return false;
+    }
+    return true;
+  }
+
+  //the neighbors from j on that do not fill a vector
+  template <class vertex, class F, class G>
+  inline void pullTail(vertex* v, const uintE* nghs, size_t j, size_t d,
+                       const uint64_t* b, long v_id, F& f, G& g) {
+    for (; j<d; j++)
+      if (bitmap::get(b, nghs[j]) && !pullHits(v, nghs, j, 1, v_id, f, g)) return;
+  }
+
+  template <class vertex, class F, class G>
+  __attribute__((target("avx2")))
+  void pullAVX2(vertex* v, const uint64_t* b, long v_id, F& f, G& g) {
+    const uintE* nghs = v->getInNeighbors();
+    size_t d = v->getInDegree(), j = 0;
+    const int* words = (const int*) b; //32-bit words of the bitmap
+    const __m256i low = _mm256_set1_epi32(31);
+    for (; j+8 <= d; j += 8) {
+      __m256i id = _mm256_loadu_si256((const __m256i*) (nghs + j));
+      __m256i w = _mm256_i32gather_epi32(words, _mm256_srli_epi32(id, 5), 4);
+      //move each neighbor's bit to the sign bit of its lane
+      __m256i bit = _mm256_sllv_epi32(w, _mm256_sub_epi32(low, _mm256_and_si256(id, low)));
+      unsigned mask = _mm256_movemask_ps(_mm256_castsi256_ps(bit));
+      if (mask && !pullHits(v, nghs, j, mask, v_id, f, g)) return;
+    }
+    pullTail(v, nghs, j, d, b, v_id, f, g);
+  }
+
+  template <class vertex, class F, class G>
+  __attribute__((target("avx512f")))
+  void pullAVX512(vertex* v, const uint64_t* b, long v_id, F& f, G& g) {
+    const uintE* nghs = v->getInNeighbors();
+    size_t d = v->getInDegree(), j = 0;
+    const int* words = (const int*) b;
+    const __m512i low = _mm512_set1_epi32(31), one = _mm512_set1_epi32(1);
+    for (; j+16 <= d; j += 16) {
+      __m512i id = _mm512_loadu_si512(nghs + j);
+      __m512i w = _mm512_i32gather_epi32(_mm512_srli_epi32(id, 5), words, 4);
+      __m512i bit = _mm512_srlv_epi32(w, _mm512_and_si512(id, low));
+      unsigned mask = _mm512_test_epi32_mask(bit, one);
+      if (mask && !pullHits(v, nghs, j, mask, v_id, f, g)) return;
+    }
+    pullTail(v, nghs, j, d, b, v_id, f, g);
+  }
+
+  //returns false if the frontier is not a bitmap or the CPU has no
+  //vector gathers, leaving the neighbors to the scalar loop
+  template <class vertex, class F, class G, class VS>
+  inline bool pullSIMD(vertex* v, long v_id, VS& vs, F& f, G& g, false_type) {
+    return false;
+  }
+
+  template <class vertex, class F, class G, class VS>
+  inline bool pullSIMD(vertex* v, long v_id, VS& vs, F& f, G& g, true_type) {
+    int level = simdLevel();
+    if (level == 2) pullAVX512(v, vs.b, v_id, f, g);
+    else if (level == 1) pullAVX2(v, vs.b, v_id, f, g);
+    return level > 0;
+  }
+#endif
+
   // Used by edgeMapDense. Callers ensure cond(v_id). For each vertex, decode
   // its in-edges, and check to see whether this neighbor is in the current
   // frontier, calling update if it is. If processing the edges sequentially,
   // break once !cond(v_id).
   template <class vertex, class F, class G, class VS>
   inline void decodeInNghBreakEarly(vertex* v, long v_id, VS& vertexSubset, F &f, G &g, bool parallel = 0) {
-    uintE d = v->getInDegree();
+    uintT d = v->getInDegree();
     if (!parallel || d < 1000) {
+#ifdef SIMD_PULL
+      if (pullSIMD(v, v_id, vertexSubset, f, g, is_same<VS, bitmapView>())) return;
+#endif
       for (size_t j=0; j<d; j++) {
         uintE ngh = v->getInNeighbor(j);
         if (vertexSubset.isIn(ngh)) {
@@ -23,7 +176,7 @@ namespace decode_uncompressed {
 #endif
           g(v_id, m);
         }
-        if(!f.cond(v_id)) break;
+        if (breakEarly<F>::value && !f.cond(v_id)) break;
       }
     } else {
       parallel_for(size_t j=0; j<d; j++) {
@@ -44,10 +197,10 @@ namespace decode_uncompressed {
   // updateAtomic.
   template <class V, class F, class G>
   inline void decodeOutNgh(V* v, long i, F &f, G &g) {
-    uintE d = v->getOutDegree();
+    uintT d = v->getOutDegree();
     granular_for(j, 0, d, (d > 1000), {
       uintE ngh = v->getOutNeighbor(j);
-      if (f.cond(ngh)) {
+      if (checkCond(f, ngh)) {
 #ifndef WEIGHTED
       auto m = f.updateAtomic(i,ngh);
 #else
@@ -62,10 +215,10 @@ namespace decode_uncompressed {
   // updateAtomic.
   template <class V, class F, class G>
   inline void decodeOutNghSparse(V* v, long i, uintT o, F &f, G &g) {
-    uintE d = v->getOutDegree();
+    uintT d = v->getOutDegree();
     granular_for(j, 0, d, (d > 1000), {
       uintE ngh = v->getOutNeighbor(j);
-      if (f.cond(ngh)) {
+      if (checkCond(f, ngh)) {
 #ifndef WEIGHTED
         auto m = f.updateAtomic(i, ngh);
 #else
@@ -78,15 +231,34 @@ namespace decode_uncompressed {
     });
   }
 
+  // Used by the edge-balanced edgeMapSparse (edge_parallel). Like
+  // decodeOutNghSparse, for the out-edges j in [lo, hi) only.
+  template <class V, class F, class G>
+  inline void decodeOutNghSparseRange(V* v, long i, uintT o, uintT lo, uintT hi, F &f, G &g) {
+    for (uintT j=lo; j<hi; j++) {
+      uintE ngh = v->getOutNeighbor(j);
+      if (checkCond(f, ngh)) {
+#ifndef WEIGHTED
+        auto m = f.updateAtomic(i, ngh);
+#else
+        auto m = f.updateAtomic(i, ngh, v->getOutWeight(j));
+#endif
+        g(ngh, o+j, m);
+      } else {
+        g(ngh, o+j);
+      }
+    }
+  }
+
   // Used by edgeMapSparse_no_filter. Sequentially decode the out-neighbors,
   // and compactly write all neighbors satisfying g().
   template <class V, class F, class G>
   inline size_t decodeOutNghSparseSeq(V* v, long i, uintT o, F &f, G &g) {
-    uintE d = v->getOutDegree();
+    uintT d = v->getOutDegree();
     size_t k = 0;
     for (size_t j=0; j<d; j++) {
       uintE ngh = v->getOutNeighbor(j);
-      if (f.cond(ngh)) {
+      if (checkCond(f, ngh)) {
 #ifndef WEIGHTED
         auto m = f.updateAtomic(i, ngh);
 #else
@@ -103,7 +275,7 @@ namespace decode_uncompressed {
   // that satisfy f.
   template <class V, class F>
   inline size_t countOutNgh(V* v, long vtx_id, F& f) {
-    uintE d = v->getOutDegree();
+    uintT d = v->getOutDegree();
     if (d < 2000) {
       size_t ct = 0;
       for (size_t i=0; i<d; i++) {
@@ -129,7 +301,7 @@ namespace decode_uncompressed {
 #ifndef WEIGHTED
           if (f(vtx_id, ngh))
 #else
-          if (f(vtx_id, ngh, v->getOutNeighbor(j)))
+          if (f(vtx_id, ngh, v->getOutWeight(j)))
 #endif
             ct++;
         }
@@ -144,7 +316,7 @@ namespace decode_uncompressed {
   // using g.
   template <class V, class E, class F, class G>
   inline void copyOutNgh(V* v, long src, uintT o, F& f, G& g) {
-    uintE d = v->getOutDegree();
+    uintT d = v->getOutDegree();
     granular_for(j, 0, d, (d > 1000), {
       uintE ngh = v->getOutNeighbor(j);
 #ifdef WEIGHTED
@@ -159,7 +331,7 @@ namespace decode_uncompressed {
   // TODO(laxmand): Add support for weighted graphs.
   template <class V, class Pred>
   inline size_t packOutNgh(V* v, long vtx_id, Pred& p, bool* bits, uintE* tmp) {
-    uintE d = v->getOutDegree();
+    uintT d = v->getOutDegree();
     if (d < 5000) {
       size_t k = 0;
       for (size_t i=0; i<d; i++) {
@@ -186,19 +358,26 @@ namespace decode_uncompressed {
 }
 
 struct symmetricVertex {
-#ifndef WEIGHTED
+#if !defined(WEIGHTED) || defined(SOA)
   uintE* neighbors;
 #else
   intE* neighbors;
+#endif
+#if defined(WEIGHTED) && defined(SOA)
+  weightT* weights;
 #endif
   uintT degree;
   void del() {free(neighbors); }
 #ifndef WEIGHTED
 symmetricVertex(uintE* n, uintT d)
+: neighbors(n), degree(d) {}
+#elif defined(SOA)
+symmetricVertex(uintE* n, weightT* w, uintT d)
+: neighbors(n), weights(w), degree(d) {}
 #else
 symmetricVertex(intE* n, uintT d)
-#endif
 : neighbors(n), degree(d) {}
+#endif
 #ifndef WEIGHTED
   uintE* getInNeighbors () { return neighbors; }
   const uintE* getInNeighbors () const { return neighbors; }
@@ -211,6 +390,23 @@ symmetricVertex(intE* n, uintT d)
   void setOutNeighbor(uintT j, uintE ngh) { neighbors[j] = ngh; }
   void setInNeighbors(uintE* _i) { neighbors = _i; }
   void setOutNeighbors(uintE* _i) { neighbors = _i; }
+#elif defined(SOA)
+  uintE* getInNeighbors () { return neighbors; }
+  const uintE* getInNeighbors () const { return neighbors; }
+  uintE* getOutNeighbors () { return neighbors; }
+  const uintE* getOutNeighbors () const { return neighbors; }
+  uintE getInNeighbor(uintT j) const { return neighbors[j]; }
+  uintE getOutNeighbor(uintT j) const { return neighbors[j]; }
+  weightT getInWeight(uintT j) const { return weights[j]; }
+  weightT getOutWeight(uintT j) const { return weights[j]; }
+  void setInNeighbor(uintT j, uintE ngh) { neighbors[j] = ngh; }
+  void setOutNeighbor(uintT j, uintE ngh) { neighbors[j] = ngh; }
+  void setInWeight(uintT j, weightT wgh) { weights[j] = wgh; }
+  void setOutWeight(uintT j, weightT wgh) { weights[j] = wgh; }
+  void setInNeighbors(uintE* _i) { neighbors = _i; }
+  void setOutNeighbors(uintE* _i) { neighbors = _i; }
+  void setInWeights(weightT* _w) { weights = _w; }
+  void setOutWeights(weightT* _w) { weights = _w; }
 #else
   //weights are stored in the entry after the neighbor ID
   //so size of neighbor list is twice the degree
@@ -251,6 +447,11 @@ symmetricVertex(intE* n, uintT d)
     decode_uncompressed::decodeOutNghSparse<symmetricVertex, F>(this, i, o, f, g);
   }
 
+  template <class F, class G>
+  inline void decodeOutNghSparseRange(long i, uintT o, uintT lo, uintT hi, F &f, G &g) {
+    decode_uncompressed::decodeOutNghSparseRange<symmetricVertex, F>(this, i, o, lo, hi, f, g);
+  }
+
   template <class F, class G>
   inline size_t decodeOutNghSparseSeq(long i, uintT o, F &f, G &g) {
     return decode_uncompressed::decodeOutNghSparseSeq<symmetricVertex, F>(this, i, o, f, g);
@@ -274,20 +475,28 @@ symmetricVertex(intE* n, uintT d)
 };
 
 struct asymmetricVertex {
-#ifndef WEIGHTED
+#if !defined(WEIGHTED) || defined(SOA)
   uintE* inNeighbors, *outNeighbors;
 #else
   intE* inNeighbors, *outNeighbors;
+#endif
+#if defined(WEIGHTED) && defined(SOA)
+  weightT* inWeights, *outWeights;
 #endif
   uintT outDegree;
   uintT inDegree;
   void del() {free(inNeighbors); free(outNeighbors);}
 #ifndef WEIGHTED
 asymmetricVertex(uintE* iN, uintE* oN, uintT id, uintT od)
+: inNeighbors(iN), outNeighbors(oN), inDegree(id), outDegree(od) {}
+#elif defined(SOA)
+asymmetricVertex(uintE* iN, uintE* oN, weightT* iW, weightT* oW, uintT id, uintT od)
+: inNeighbors(iN), outNeighbors(oN), inWeights(iW), outWeights(oW),
+  inDegree(id), outDegree(od) {}
 #else
 asymmetricVertex(intE* iN, intE* oN, uintT id, uintT od)
-#endif
 : inNeighbors(iN), outNeighbors(oN), inDegree(id), outDegree(od) {}
+#endif
 #ifndef WEIGHTED
   uintE* getInNeighbors () { return inNeighbors; }
   const uintE* getInNeighbors () const { return inNeighbors; }
@@ -299,6 +508,23 @@ asymmetricVertex(intE* iN, intE* oN, uintT id, uintT od)
   void setOutNeighbor(uintT j, uintE ngh) { outNeighbors[j] = ngh; }
   void setInNeighbors(uintE* _i) { inNeighbors = _i; }
   void setOutNeighbors(uintE* _i) { outNeighbors = _i; }
+#elif defined(SOA)
+  uintE* getInNeighbors () { return inNeighbors; }
+  const uintE* getInNeighbors () const { return inNeighbors; }
+  uintE* getOutNeighbors () { return outNeighbors; }
+  const uintE* getOutNeighbors () const { return outNeighbors; }
+  uintE getInNeighbor(uintT j) const { return inNeighbors[j]; }
+  uintE getOutNeighbor(uintT j) const { return outNeighbors[j]; }
+  weightT getInWeight(uintT j) const { return inWeights[j]; }
+  weightT getOutWeight(uintT j) const { return outWeights[j]; }
+  void setInNeighbor(uintT j, uintE ngh) { inNeighbors[j] = ngh; }
+  void setOutNeighbor(uintT j, uintE ngh) { outNeighbors[j] = ngh; }
+  void setInWeight(uintT j, weightT wgh) { inWeights[j] = wgh; }
+  void setOutWeight(uintT j, weightT wgh) { outWeights[j] = wgh; }
+  void setInNeighbors(uintE* _i) { inNeighbors = _i; }
+  void setOutNeighbors(uintE* _i) { outNeighbors = _i; }
+  void setInWeights(weightT* _w) { inWeights = _w; }
+  void setOutWeights(weightT* _w) { outWeights = _w; }
 #else
   intE* getInNeighbors () { return inNeighbors; }
   const intE* getInNeighbors () const { return inNeighbors; }
@@ -320,7 +546,12 @@ asymmetricVertex(intE* iN, intE* oN, uintT id, uintT od)
   uintT getOutDegree() const { return outDegree; }
   void setInDegree(uintT _d) { inDegree = _d; }
   void setOutDegree(uintT _d) { outDegree = _d; }
+#if defined(WEIGHTED) && defined(SOA)
+  void flipEdges() { swap(inNeighbors,outNeighbors); swap(inWeights,outWeights);
+    swap(inDegree,outDegree); }
+#else
   void flipEdges() { swap(inNeighbors,outNeighbors); swap(inDegree,outDegree); }
+#endif
 
   template <class VS, class F, class G>
   inline void decodeInNghBreakEarly(long v_id, VS& vertexSubset, F &f, G &g, bool parallel = 0) {
@@ -337,6 +568,11 @@ asymmetricVertex(intE* iN, intE* oN, uintT id, uintT od)
     decode_uncompressed::decodeOutNghSparse<asymmetricVertex, F>(this, i, o, f, g);
   }
 
+  template <class F, class G>
+  inline void decodeOutNghSparseRange(long i, uintT o, uintT lo, uintT hi, F &f, G &g) {
+    decode_uncompressed::decodeOutNghSparseRange<asymmetricVertex, F>(this, i, o, lo, hi, f, g);
+  }
+
   template <class F, class G>
   inline size_t decodeOutNghSparseSeq(long i, uintT o, F &f, G &g) {
     return decode_uncompressed::decodeOutNghSparseSeq<asymmetricVertex, F>(this, i, o, f, g);
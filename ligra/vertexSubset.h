@@ -2,13 +2,87 @@
 
 #include <functional>
 #include <limits>
+#include <stdint.h>
 
 #include "index_map.h"
 #include "maybe.h"
 #include "sequence.h"
+#include "bigAlloc.h"
 
 using namespace std;
 
+// Dense vertexSubsets without data can be stored as bitmaps, bit v%64 of
+// 64-bit word v/64 telling whether vertex v is in the set. This is what
+// edgeMapDense returns and toDense builds: n/8 bytes instead of the n of
+// a bool array, with the vertex count taken by popcount and toSparse
+// iterating over the set bits of each word. Bool arrays passed by the
+// applications are still used as they are.
+namespace bitmap {
+  inline size_t words(size_t n) { return (n+63)/64; }
+
+  inline bool get(const uint64_t* b, size_t v) { return (b[v>>6] >> (v&63)) & 1; }
+
+  inline void setAtomic(uint64_t* b, size_t v) {
+    uint64_t bit = (uint64_t) 1 << (v&63);
+    if (!(b[v>>6] & bit)) __sync_fetch_and_or(&b[v>>6], bit);
+  }
+
+  //a bitmap of n vertices with no vertex set
+  inline uint64_t* empty(size_t n) {
+    size_t W = words(n);
+    uint64_t* b = newPoolA(uint64_t, W);
+    {parallel_for(size_t w=0;w<W;w++) b[w] = 0;}
+    return b;
+  }
+
+  inline size_t count(const uint64_t* b, size_t n) {
+    auto cts = make_in_imap<size_t>(words(n), [&] (size_t w) {
+        return (size_t) __builtin_popcountll(b[w]); });
+    return pbbs::reduce_add(cts);
+  }
+
+  //bitmap of the m vertices in s
+  inline uint64_t* fromIndices(const uintE* s, size_t m, size_t n) {
+    uint64_t* b = empty(n);
+    {parallel_for(size_t i=0;i<m;i++) setAtomic(b, s[i]);}
+    return b;
+  }
+
+  inline uint64_t* fromBools(const bool* d, size_t n) {
+    size_t W = words(n);
+    uint64_t* b = newPoolA(uint64_t, W);
+    {parallel_for(size_t w=0;w<W;w++) {
+      uint64_t x = 0;
+      size_t end = min(n, 64*w+64);
+      for (size_t v=64*w; v<end; v++) x |= (uint64_t) d[v] << (v&63);
+      b[w] = x;
+      }}
+    return b;
+  }
+
+  //the m vertices of b in increasing order
+  inline uintE* toIndices(const uint64_t* b, size_t n, size_t m) {
+    size_t W = words(n);
+    auto offsets = array_imap<uintE>(W, [&] (size_t w) {
+        return (uintE) __builtin_popcountll(b[w]); });
+    size_t total = pbbs::scan_add(offsets, offsets);
+    if (total != m) {
+      cout << "bad stored value of m" << endl;
+      abort();
+    }
+    uintE* s = newPoolA(uintE, m);
+    {parallel_for(size_t w=0;w<W;w++) {
+      uint64_t x = b[w];
+      uintE o = offsets[w];
+      while (x) {
+        s[o++] = 64*w + __builtin_ctzll(x);
+        x &= x-1;
+      }
+      }}
+    return s;
+  }
+}
+
 template <class data>
 struct vertexSubsetData {
   using S = tuple<uintE, data>;
@@ -37,8 +111,8 @@ struct vertexSubsetData {
   : n(0), m(0), s(NULL), d(NULL), isDense(0) { }
 
   void del() {
-    if (d != NULL) free(d);
-    if (s != NULL) free(s);
+    if (d != NULL) bigFree(d);
+    if (s != NULL) bigFree(s);
   }
 
   // Sparse
@@ -93,7 +167,7 @@ struct vertexSubsetData {
   // Convert to dense but keep sparse representation if it exists.
   void toDense() {
     if (d == NULL) {
-      d = newA(D, n);
+      d = newPoolA(D, n);
       {parallel_for(long i=0;i<n;i++) std::get<0>(d[i]) = false;}
       {parallel_for(long i=0;i<m;i++)
         d[std::get<0>(s[i])] = make_tuple(true, std::get<1>(s[i]));}
@@ -114,31 +188,31 @@ struct vertexSubsetData<pbbs::empty> {
   using S = uintE;
 
   // An empty vertex set.
-  vertexSubsetData<pbbs::empty>(size_t _n) : n(_n), m(0), d(NULL), s(NULL), isDense(0) {}
+  vertexSubsetData<pbbs::empty>(size_t _n) : n(_n), m(0), d(NULL), s(NULL), b(NULL), isDense(0) {}
 
   // A vertexSubset with a single vertex.
   vertexSubsetData<pbbs::empty>(long _n, uintE v)
-  : n(_n), m(1), d(NULL), isDense(0) {
+  : n(_n), m(1), d(NULL), b(NULL), isDense(0) {
     s = newA(uintE, 1);
     s[0] = v;
   }
 
   // A vertexSubset from array of vertex indices.
   vertexSubsetData<pbbs::empty>(long _n, long _m, S* indices)
-  : n(_n), m(_m), s(indices), d(NULL), isDense(0) {}
+  : n(_n), m(_m), s(indices), d(NULL), b(NULL), isDense(0) {}
 
   // A vertexSubset from array of vertex indices.
   vertexSubsetData<pbbs::empty>(long _n, long _m, tuple<uintE, pbbs::empty>* indices)
-  : n(_n), m(_m), s((uintE*)indices), d(NULL), isDense(0) {}
+  : n(_n), m(_m), s((uintE*)indices), d(NULL), b(NULL), isDense(0) {}
 
   // A vertexSubset from boolean array giving number of true values.
   vertexSubsetData<pbbs::empty>(long _n, long _m, bool* _d)
-  : n(_n), m(_m), s(NULL), d(_d), isDense(1)  {}
+  : n(_n), m(_m), s(NULL), d(_d), b(NULL), isDense(1)  {}
 
   // A vertexSubset from boolean array giving number of true values. Calculate
   // number of nonzeros and store in m.
   vertexSubsetData<pbbs::empty>(long _n, bool* _d)
-  : n(_n), s(NULL), d(_d), isDense(1) {
+  : n(_n), s(NULL), d(_d), b(NULL), isDense(1) {
     auto d_map = make_in_imap<size_t>(n, [&] (size_t i) { return _d[i]; });
     auto f = [&] (size_t i, size_t j) { return i + j; };
     m = pbbs::reduce(d_map, f);
@@ -147,15 +221,25 @@ struct vertexSubsetData<pbbs::empty> {
   // A vertexSubset from boolean array giving number of true values. Calculate
   // number of nonzeros and store in m.
  vertexSubsetData<pbbs::empty>(long _n, tuple<bool, pbbs::empty>* _d)
-  : n(_n), s(NULL), d((bool*)_d), isDense(1)  {
+  : n(_n), s(NULL), d((bool*)_d), b(NULL), isDense(1)  {
     auto d_map = make_in_imap<size_t>(n, [&] (size_t i) { return get<0>(_d[i]); });
     auto f = [&] (size_t i, size_t j) { return i + j; };
     m = pbbs::reduce(d_map, f);
   }
 
+  // A vertexSubset from a bitmap (see above), counting its vertices.
+  static vertexSubsetData<pbbs::empty> fromBitmap(long _n, uint64_t* _b) {
+    vertexSubsetData<pbbs::empty> vs(_n);
+    vs.b = _b;
+    vs.m = bitmap::count(_b, _n);
+    vs.isDense = 1;
+    return vs;
+  }
+
   void del() {
-    if (d != NULL) free(d);
-    if (s != NULL) free(s);
+    if (d != NULL) bigFree(d);
+    if (s != NULL) bigFree(s);
+    if (b != NULL) bigFree(b);
   }
 
   // Sparse
@@ -164,7 +248,9 @@ struct vertexSubsetData<pbbs::empty> {
   inline tuple<uintE, pbbs::empty> vtxAndData(const uintE& i) const { return make_tuple(s[i], pbbs::empty()); }
 
   // Dense
-  inline bool isIn(const uintE& v) const { return d[v]; }
+  inline bool isIn(const uintE& v) const {
+    return b != NULL ? bitmap::get(b, v) : d[v];
+  }
   inline pbbs::empty ithData(const uintE& v) const { return pbbs::empty(); }
 
   // Returns (uintE) -> Maybe<tuple<vertex, vertex-data>>.
@@ -173,7 +259,7 @@ struct vertexSubsetData<pbbs::empty> {
     if (isDense) {
       fn = [&] (const uintE& v) -> Maybe<tuple<uintE, pbbs::empty>> {
         auto ret = Maybe<tuple<uintE, pbbs::empty>>(make_tuple(v, pbbs::empty()));
-        ret.exists = d[v];
+        ret.exists = isIn(v);
         return ret;
       };
     } else {
@@ -194,7 +280,8 @@ struct vertexSubsetData<pbbs::empty> {
   bool dense() { return isDense; }
 
   void toSparse() {
-    if (s == NULL && m > 0) {
+    if (s == NULL && m > 0 && b != NULL) s = bitmap::toIndices(b, n, m);
+    else if (s == NULL && m > 0) {
       auto _d = d;
       auto f = [&] (size_t i) { return _d[i]; };
       auto f_in = make_in_imap<bool>(n, f);
@@ -210,20 +297,80 @@ struct vertexSubsetData<pbbs::empty> {
     isDense = false;
   }
 
-  // Converts to dense but keeps sparse representation if it exists.
+  // Converts to dense (as a bitmap) but keeps sparse representation if it
+  // exists.
   void toDense() {
-    if (d == NULL) {
-      d = newA(bool,n);
-      {parallel_for(long i=0;i<n;i++) d[i] = 0;}
-      {parallel_for(long i=0;i<m;i++) d[s[i]] = 1;}
-    }
+    if (d == NULL && b == NULL) b = bitmap::fromIndices(s, m, n);
+    isDense = true;
+  }
+
+  // Converts to a dense bitmap, also when the dense form is a bool array.
+  void toBitmap() {
+    if (b == NULL) b = d != NULL ? bitmap::fromBools(d, n) : bitmap::fromIndices(s, m, n);
     isDense = true;
   }
 
   S* s;
   bool* d;
+  uint64_t* b;
   size_t n, m;
   bool isDense;
 };
 
 using vertexSubset = vertexSubsetData<pbbs::empty>;
+
+// Membership tests of one dense form, so that loops calling isIn for
+// every edge do not check which form a vertexSubset uses each time.
+struct bitmapView {
+  const uint64_t* b;
+  inline bool isIn(const uintE& v) const { return bitmap::get(b, v); }
+};
+
+struct boolView {
+  const bool* d;
+  inline bool isIn(const uintE& v) const { return d[v]; }
+};
+
+// Calls f with a view of the dense vertexSubset vs, or with vs itself if
+// it has data.
+template <class VS, class F>
+auto denseView(VS& vs, F f) { return f(vs); }
+
+template <class F>
+auto denseView(vertexSubset& vs, F f) {
+  if (vs.b != NULL) {
+    bitmapView view = {vs.b};
+    return f(view);
+  }
+  boolView view = {vs.d};
+  return f(view);
+}
+
+// Set operations on vertexSubsets, done on their bitmaps one word at a
+// time (loops the compiler vectorizes). The results are dense bitmaps.
+template <class Op>
+vertexSubset bitmapCombine(vertexSubset& A, vertexSubset& B, Op op) {
+  if (A.numRows() != B.numRows()) {
+    cout << "vertexSubset: Sizes Don't match" << endl;
+    abort();
+  }
+  size_t n = A.numRows(), W = bitmap::words(n);
+  A.toBitmap(); B.toBitmap();
+  uint64_t* a = A.b, *b = B.b;
+  uint64_t* out = newPoolA(uint64_t, W);
+  {parallel_for(size_t w=0;w<W;w++) out[w] = op(a[w], b[w]);}
+  return vertexSubset::fromBitmap(n, out);
+}
+
+inline vertexSubset vertexUnion(vertexSubset& A, vertexSubset& B) {
+  return bitmapCombine(A, B, [] (uint64_t x, uint64_t y) { return x | y; });
+}
+
+inline vertexSubset vertexIntersection(vertexSubset& A, vertexSubset& B) {
+  return bitmapCombine(A, B, [] (uint64_t x, uint64_t y) { return x & y; });
+}
+
+// The vertices of A that are not in B.
+inline vertexSubset vertexDifference(vertexSubset& A, vertexSubset& B) {
+  return bitmapCombine(A, B, [] (uint64_t x, uint64_t y) { return x & ~y; });
+}
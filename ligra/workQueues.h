@@ -0,0 +1,118 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Per-worker work queues of the asynchronous edgeMap (the asynchronous
+// flag in ligra.h). Each worker takes batches of up to ASYNC_BATCH
+// vertices from the front of its own queue and appends the vertices they
+// activate to its back, so that vertices are processed roughly in the
+// order of a level-synchronous traversal. A worker whose queue is empty
+// steals half of the queue of another worker, trying them in turn.
+// pending counts the vertices that are queued or being processed, and
+// is raised by a batch's activations before they are queued and lowered
+// by the batch only after that; the workers stop once it reaches zero,
+// as no vertex can then be activated any more.
+#pragma once
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include "parallel.h"
+using namespace std;
+
+//vertices taken from a queue at a time
+#define ASYNC_BATCH 64
+
+struct workQueues {
+  struct queue {
+    mutex lock;
+    deque<uintE> q;
+    char pad[64];
+  };
+  vector<queue> queues;
+  atomic<long> pending;
+
+  workQueues(int workers) : queues(workers), pending(0) {}
+
+  //adds the vertices vtx(0..m-1), split evenly between the queues
+  template <class VTX>
+  void init(long m, VTX vtx) {
+    long P = queues.size();
+    {parallel_for (long w=0; w<P; w++)
+        for (long i=m*w/P; i<m*(w+1)/P; i++) queues[w].q.push_back(vtx(i));}
+    pending = m;
+  }
+
+  //fills batch with the next vertices for worker w, stealing them if
+  //its queue is empty, and waits while other workers may still activate
+  //vertices; returns false once all vertices are processed
+  bool take(int w, vector<uintE>& batch) {
+    batch.clear();
+    int P = queues.size();
+    while (true) {
+      if (pop(w, batch)) return true;
+      for (int k=1; k<P; k++)
+        if (steal(w, (w+k) % P) && pop(w, batch)) return true;
+      if (pending.load() == 0) return false;
+      this_thread::yield();
+    }
+  }
+
+  //queues the vertices out activated by the batch of worker w
+  void finish(int w, long batchSize, vector<uintE>& out) {
+    if (!out.empty()) {
+      pending += out.size();
+      lock_guard<mutex> g(queues[w].lock);
+      queues[w].q.insert(queues[w].q.end(), out.begin(), out.end());
+    }
+    pending -= batchSize;
+    out.clear();
+  }
+
+  //moves up to ASYNC_BATCH vertices from the front of w's queue to batch
+  bool pop(int w, vector<uintE>& batch) {
+    queue& Q = queues[w];
+    lock_guard<mutex> g(Q.lock);
+    long k = min((long) Q.q.size(), (long) ASYNC_BATCH);
+    batch.assign(Q.q.begin(), Q.q.begin() + k);
+    Q.q.erase(Q.q.begin(), Q.q.begin() + k);
+    return k > 0;
+  }
+
+  //moves the back half of victim's queue to the queue of worker w
+  bool steal(int w, int victim) {
+    vector<uintE> stolen;
+    {
+      queue& V = queues[victim];
+      lock_guard<mutex> g(V.lock);
+      long k = (V.q.size() + 1) / 2;
+      if (k == 0) return false;
+      stolen.assign(V.q.end() - k, V.q.end());
+      V.q.erase(V.q.end() - k, V.q.end());
+    }
+    lock_guard<mutex> g(queues[w].lock);
+    queues[w].q.insert(queues[w].q.end(), stolen.begin(), stolen.end());
+    return true;
+  }
+};
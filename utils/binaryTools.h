@@ -0,0 +1,90 @@
+// This code is part of the project "Ligra: A Lightweight Graph Processing
+// Framework for Shared Memory", presented at Principles and Practice of
+// Parallel Programming, 2013.
+// Copyright (c) 2013 Julian Shun and Guy Blelloch
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights (to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject to
+// the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+// NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+// LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+// OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Helpers shared by the tools that convert binary graphs and containers
+// (binaryAddTranspose, adjToContainer, reorderGraph).
+#pragma once
+#include "utils.h"
+#include "parallel.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+using namespace std;
+
+typedef pair<uint,int> uintPair;
+
+// Reads the whole file fname into a newly allocated buffer.
+inline char* readFile(char* fname, long& size) {
+  ifstream in(fname, ifstream::in | ios::binary);
+  if (!in.is_open()) {
+    cout << "Unable to open file: " << fname << endl;
+    abort();
+  }
+  in.seekg(0, ios::end);
+  size = in.tellg();
+  in.seekg(0);
+  char* s = (char*) malloc(size);
+  in.read(s, size);
+  in.close();
+  return s;
+}
+
+// Computes the in-edges of offsets/edges (and their weights, if weights
+// is not NULL), with each in-edge list sorted by source. tWeights is
+// NULL if weights is.
+inline void transposeEdges(long n, long m, ulong* offsets, uint* edges, int* weights,
+                           ulong*& tOffsets, uint*& tEdges, int*& tWeights) {
+  //count in-degrees and scan to get the offsets of the transpose
+  tOffsets = newA(ulong, n+1);
+  {parallel_for(long i=0;i<n+1;i++) tOffsets[i] = 0;}
+  {parallel_for(long i=0;i<n;i++) {
+    for(ulong j=offsets[i];j<offsets[i+1];j++)
+      __sync_fetch_and_add(&tOffsets[edges[j]], 1);
+    }}
+  sequence::plusScan(tOffsets, tOffsets, n+1);
+
+  //scatter each edge to its target's in-edge list; the scatter is not
+  //ordered, so each list is then sorted by source
+  ulong* pos = newA(ulong, n);
+  {parallel_for(long i=0;i<n;i++) pos[i] = tOffsets[i];}
+  uintPair* T = newA(uintPair, m);
+  {parallel_for(long i=0;i<n;i++) {
+    for(ulong j=offsets[i];j<offsets[i+1];j++) {
+      ulong p = __sync_fetch_and_add(&pos[edges[j]], 1);
+      T[p] = make_pair((uint)i, weights != NULL ? weights[j] : 0);
+    }
+    }}
+  free(pos);
+  {parallel_for(long i=0;i<n;i++)
+      sort(T+tOffsets[i], T+tOffsets[i+1]);}
+
+  tEdges = newA(uint, m);
+  {parallel_for(long i=0;i<m;i++) tEdges[i] = T[i].first;}
+  tWeights = NULL;
+  if (weights != NULL) {
+    tWeights = newA(int, m);
+    {parallel_for(long i=0;i<m;i++) tWeights[i] = T[i].second;}
+  }
+  free(T);
+}
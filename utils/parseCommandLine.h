@@ -0,0 +1 @@
+../ligra/parseCommandLine.h
\ No newline at end of file